@@ -4,12 +4,15 @@
 //
 // Modified: 2015-12-10, 2018-11-05, 2023-03-29, 2023-11-28
 
+#define _GNU_SOURCE				// semtimedop(2)
+
 #if !defined _XOPEN_SOURCE || _XOPEN_SOURCE < 600
 #	define _XOPEN_SOURCE 600	// portable usage of barriers
 #endif
 
 #include <stdio.h>
 #include <stdlib.h>				// srand(3), rand(3)
+#include <limits.h>				// LONG_MAX
 #include <sys/types.h>
 #include <unistd.h>				// getpid()
 #include <pthread.h>
@@ -19,6 +22,12 @@
 #include <sys/time.h>			// CPU time measuring
 #include <sys/resource.h>		// CPU time measuring
 #include <stdatomic.h>			// atomic_long
+#include <stdint.h>				// uint64_t
+#include <math.h>				// log(3)
+#include <sys/wait.h>			// waitpid(2)
+#if defined(__x86_64__) || defined(__i386__)
+#	include <x86intrin.h>		// __rdtsc(), __rdtscp(), _mm_lfence()
+#endif
 #include "cs_methods.h"			// methods for critical section access control
 
 #define MAX_THREADS		1024
@@ -26,15 +35,106 @@
 #define PER_THREAD		(1<<22)	// default transactions per thread
 #define THREADS			(1<<3)	// default number of threads
 #define WITHDRAW_AMOUNT	1		// amount per a transaction
+#define AMOUNT_FIXED		0		// amount distributions: always WITHDRAW_AMOUNT
+#define AMOUNT_UNIFORM		1		// uniform from 1 to 2 × AMOUNT_MEAN − 1
+#define AMOUNT_EXPONENTIAL	2		// exponential with the mean AMOUNT_MEAN
+#define AMOUNT_LARGE		3		// always AMOUNT_LARGE_VALUE
+#define AMOUNT_MAX			AMOUNT_LARGE
+#define AMOUNT_MEAN			100		// the mean of the random amounts
+#define AMOUNT_LARGE_VALUE	10000	// the fixed large amount
+#define FUNDS_RANDOM		90		// the default funds for random amounts: some transactions are rejected
+#define TRANSFER_ACCOUNTS	16		// transfers: the accounts moved between
+#define TRANSFER_BALANCE	1000000	// transfers: the initial balance of each account
+#define DURATION_BALANCE	(LONG_MAX / 2)	// initial balance for time-bounded runs
+#define STEADY_INTERVAL		100		// steady-state detection interval [ms]
+#define STEADY_INTERVALS	3		// stable intervals needed for the steady state
+#define STARVATION_SHARE	10	// a thread below 1/10 of the fair share is starving
+#define ARRIVAL_SPIN		100000	// spin instead of sleep for arrivals closer than this [ns]
+#define LATENCY_SUB_BITS	4		// latency histogram: 16 sub-buckets per power of two
+#define LATENCY_BUCKETS		(64 << LATENCY_SUB_BITS)
+#define RT_HIGH_SHARE		4		// real-time mode: every 4th thread has the high priority
+#define RT_WATCHDOG			5000	// real-time mode: default watchdog timeout, a spinlock livelocks [ms]
+#define EXIT_STALLED		4		// the watchdog found no progress
+#define EXIT_LOST			5		// lost transactions or an overdraft detected
+#define STRESS_TRANSACTIONS	10000	// stress mode: default transactions per thread of a burst
+#define STRESS_WATCHDOG		5000	// stress mode: default watchdog timeout of a burst [ms]
+#define MICRO_REPEATS		5		// microbenchmark: the fastest of 5 repetitions is taken
+#define TSC_CALIBRATION		20000000	// microbenchmark: the time stamp counter is calibrated for 20 ms [ns]
 
 bool do_sync_start = true;		// always synchronous start
 
 long per_thread = PER_THREAD;	// transactions per thread
+double duration = 0;			// run time in seconds, 0 = use per_thread
+atomic_bool stop_run = false;	// set when the duration elapses
+long warmup = 0;				// warm-up transactions per thread, not measured
+double steady_tolerance = 0;	// steady-state throughput tolerance in %, 0 = off
+long sample_interval = 0;		// throughput sampling interval [ms], 0 = off
+double arrival_rate = 0;		// open loop: arrivals per second per thread, 0 = closed loop
+bool arrival_poisson = false;	// open loop: exponential inter-arrival times
+atomic_int threads_running;		// threads still doing transactions
 int thread_count = THREADS;		// the number of threads
 volatile long balance;			// shared variable, initial balance
 volatile atomic_long balance_atomic;	// used for atomic solution
+volatile long *balance_word = &balance;	// the balance used, -L places it by the lock words
+volatile atomic_long *balance_atomic_word = &balance_atomic;	// the atomic balance used, placed likewise
+struct versioned_balance {		// CS_METHOD_OCC: committed together by a double-width CAS
+	long version;
+	long balance;
+};
+_Atomic struct versioned_balance balance_versioned;	// CS_METHOD_OCC
+struct transfer_account {		// the accounts of the transfers
+	atomic_long lock;			// CS_METHOD_OCC: the version × 2, +1 while a commit writes
+	atomic_long balance;		// relaxed accesses: read optimistically while written
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct transfer_account accounts[TRANSFER_ACCOUNTS];
 
 long withdrawn[MAX_THREADS];	// the amount withdrawn by each thread
+long withdrawn_warmup[MAX_THREADS];	// the amount withdrawn during the warm-up
+long rejected[MAX_THREADS];		// the transactions rejected for insufficient funds
+long deposited[MAX_THREADS];	// the amount deposited by each thread, the warm-up included
+long deposit_ratio = 0;			// deposits in % of the transactions, the rest are withdrawals
+long transfer_ratio = 0;		// transfers between the accounts in % of the transactions
+long transferred[MAX_THREADS];	// the transfers done by each thread, the warm-up included
+long transfer_stripes = 0;		// transfers under lock instances striping the accounts, 0 = under the -m lock
+long stripes_initialized = 0;	// the stripe locks to destroy
+struct cs_lock stripe_locks[TRANSFER_ACCOUNTS];	// the account i is under the lock i % transfer_stripes
+int amount_distribution = AMOUNT_FIXED;	// the distribution of the amounts
+long funds = -1;				// the initial balance in % of the expected demand, −1 = default
+struct thread_counters {		// written by each thread on every transaction: a cache line each
+	volatile long transactions;	// the transactions performed, read by the main thread for progress
+	volatile long warmup_transactions;	// the warm-up ones, rejected included: progress too
+	long latency_max;			// open loop: the longest scheduled → completed [ns]
+	long queueing_max;			// open loop: the longest scheduled → lock acquired [ns]
+	long aborts;				// CS_METHOD_OCC: the commits that conflicted and were retried
+	uint64_t amount_state;		// the random amounts, xorshift: no lock like rand(3)
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct thread_counters thread_counters[MAX_THREADS];
+long latency_hist[MAX_THREADS][LATENCY_BUCKETS];	// open loop: scheduled → completed
+long queueing_hist[MAX_THREADS][LATENCY_BUCKETS];	// open loop: scheduled → lock acquired
+long wait_max[MAX_THREADS];		// the longest lock acquisition of each thread [ns]
+int thread_node[MAX_THREADS];	// the NUMA node each thread ended on
+int numa_node = -1;				// the node for the shared data, −1 = where first touched
+int rt_policy = SCHED_OTHER;	// real-time mode: SCHED_FIFO or SCHED_RR, SCHED_OTHER = off
+long watchdog_timeout = 0;		// abort when no thread progresses for this time [ms], 0 = off
+volatile bool thread_finished[MAX_THREADS];	// the thread left the transaction loop
+long litmus_iterations = 0;		// run the store buffering litmus test instead, 0 = off
+long micro_rounds = 0;			// run the uncontended and the ping-pong microbenchmark instead, 0 = off
+atomic_int pingpong_turn;		// microbenchmark: the thread to hand the lock over next
+pthread_barrier_t pingpong_barrier;	// microbenchmark: the threads start together with the timing
+long stress_bursts = 0;			// stress mode: short runs with random settings, 0 = off
+bool stress_child = false;		// stress mode: this process runs one burst
+bool pin_threads = false;		// stress mode: bind each thread to one CPU
+bool inject_yields = false;		// stress mode: sched_yield(2) inside the critical section
+atomic_int litmus_x, litmus_y;	// litmus test: each thread stores one and loads the other
+int litmus_loaded[2];			// litmus test: the values loaded
+pthread_barrier_t litmus_barrier;	// litmus test: the rounds start and end together
+const char *order_names[] = { "default", "seq_cst", "acq_rel", "relaxed" };
+const char *layout_names[] = { "linked", "shared", "padded" };
+
+bool measure_wait = false;		// time each lock acquisition
+int owner_last = -1;			// the last thread that entered the critical section
+long owner_run;					// consecutive acquisitions by owner_last
+long owner_run_longest;			// the longest run of consecutive acquisitions
 
 int verbose = 1;				// verbosity
 int cs_method = -1;				// a command-line option
@@ -47,6 +147,9 @@ struct timespec real_time1, real_time2;	// counting the real time
 struct rusage CPU_time1, CPU_time2;		// counting the CPU clocks
 double real_time;						// time spent executing the process
 double CPU_time_user, CPU_time_system;	// time spent on the CPU
+bool steady_reached = false;			// the steady state was detected
+double steady_time;						// time to reach the steady state [s]
+double steady_rate;						// steady-state throughput [transactions/s]
  
 // prototypes
 void eval_args(int argc, char *argv[]);
@@ -63,6 +166,8 @@ void release_resources(void)
 			sync_start_barrier_initialized = false;
 	}
 	// destroy resources used for the critical section access control
+	while (stripes_initialized > 0)
+		cs_lock_destroy(&stripe_locks[--stripes_initialized]);
 	cs_destroy();
 }
 
@@ -73,14 +178,20 @@ void time_init(void)
 	getrusage(RUSAGE_SELF, &CPU_time1);				// initialize the CPU time
 }
 
-// synchronize start of all threads
+// synchronize start of all threads, the measuring starts by the last one
+// the workers (tid ≥ 0) forget their own warm-up statistics before the barrier:
+// once it opens, the others are already counting the measured transactions
 // synchronizace startu vláken
-static void sync_threads(void)
+static void sync_threads(int tid, const char *phase)
 {
+	if (tid >= 0) {
+		rejected[tid] = 0;
+		wait_max[tid] = 0;
+	}
 	switch ((errno = pthread_barrier_wait(&sync_start_barrier))) {
 		case PTHREAD_BARRIER_SERIAL_THREAD:
 			if (verbose)
-		      	printf("All threads have started transactions.\n");
+		      	printf("All threads have started %s.\n", phase);
 			time_init();
 		case 0:
 			break;
@@ -90,49 +201,414 @@ static void sync_threads(void)
 	}
 }
 
+// the difference of two time points in nanoseconds
+FORCE_INLINE
+long time_diff_ns(struct timespec *t1, struct timespec *t2)
+{
+	return (t2->tv_sec - t1->tv_sec) * 1000000000L + (t2->tv_nsec - t1->tv_nsec);
+}
+
+// the monotonic time in nanoseconds
+FORCE_INLINE
+long time_now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+// xorshift64* pseudo-random numbers, the state is per thread (rand(3) takes a lock)
+FORCE_INLINE
+uint64_t random_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// a pseudo-random number from the interval [0, 1)
+FORCE_INLINE
+double random_unit(uint64_t *state)
+{
+	return (random_next(state) >> 11) * (1.0 / (1ULL << 53));
+}
+
+// the amount of the next transaction of the thread
+FORCE_INLINE
+long draw_amount(int tid)
+{
+	switch (amount_distribution) {
+	case AMOUNT_UNIFORM:
+		return 1 + random_next(&thread_counters[tid].amount_state) % (2 * AMOUNT_MEAN - 1);
+	case AMOUNT_EXPONENTIAL:
+		return 1 + (long) (-log(1.0 - random_unit(&thread_counters[tid].amount_state)) * (AMOUNT_MEAN - 1));
+	case AMOUNT_LARGE:
+		return AMOUNT_LARGE_VALUE;
+	default:
+		return WITHDRAW_AMOUNT;		// for the sake of measuring, it’s always the same
+	}
+}
+
+// the mean amount of a transaction
+long amount_mean(void)
+{
+	switch (amount_distribution) {
+	case AMOUNT_UNIFORM:
+	case AMOUNT_EXPONENTIAL:
+		return AMOUNT_MEAN;
+	case AMOUNT_LARGE:
+		return AMOUNT_LARGE_VALUE;
+	default:
+		return WITHDRAW_AMOUNT;
+	}
+}
+
+// the histogram bucket of the value: exact below 16, then 16 buckets per power of two
+FORCE_INLINE
+int latency_bucket(long value)
+{
+	int msb;
+
+	if (value < (1 << LATENCY_SUB_BITS))
+		return value < 0 ? 0 : value;
+	msb = 63 - __builtin_clzl(value);
+	return ((msb - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+			+ (int) ((value >> (msb - LATENCY_SUB_BITS)) - (1 << LATENCY_SUB_BITS));
+}
+
+// the lowest value of the histogram bucket
+long latency_bucket_value(int bucket)
+{
+	int group = bucket >> LATENCY_SUB_BITS;
+
+	if (group == 0)
+		return bucket;
+	return (long) ((1 << LATENCY_SUB_BITS) + (bucket & ((1 << LATENCY_SUB_BITS) - 1)))
+			<< (group - 1);
+}
+
+// count consecutive acquisitions by the same thread, called inside the critical section
+FORCE_INLINE
+void track_handoff(int tid)
+{
+	if (owner_last == tid)
+		++owner_run;
+	else {
+		owner_last = tid;
+		owner_run = 1;
+	}
+	if (owner_run > owner_run_longest)
+		owner_run_longest = owner_run;
+}
+
+// the balance kept by the method used
+FORCE_INLINE
+long current_balance(void)
+{
+	switch (cs_method) {
+	case CS_METHOD_ATOMIC:
+		return atomic_load(balance_atomic_word);
+	case CS_METHOD_OCC:
+		return atomic_load(&balance_versioned).balance;
+	default:
+		return *balance_word;
+	}
+}
+
 // withdraw given amount, returns true if the transaction was successful, false otherwise
 FORCE_INLINE
 bool withdraw(long amount) {
+	long current;
+
 	if (cs_method == CS_METHOD_ATOMIC) {	// use atomic type
 		// check if the transaction can be done
-		if (balance_atomic < amount)		// if not enough: reject withdrawal
+		if (*balance_atomic_word < amount)	// if not enough: reject withdrawal
 			return false;
-		balance_atomic -= amount;			// do withdrawal
+		if (inject_yields)					// stress mode: widen the window after the check
+			sched_yield();
+		*balance_atomic_word -= amount;		// do withdrawal
 	}
 	else {
 		// check if the transaction can be done
-		if (balance < amount)		// if not enough: reject withdrawal
+		if ((current = *balance_word) < amount)	// if not enough: reject withdrawal
 			return false;
-		balance -= amount;			// do withdrawal
+		if (inject_yields)			// stress mode: widen the window between the read and the write
+			sched_yield();
+		*balance_word = current - amount;	// do withdrawal
 	}
 	return true;
 }
 
+// deposit the amount, always succeeds
+// vklad částky, vždy uspěje
+FORCE_INLINE
+bool deposit(long amount) {
+	long current;
+
+	if (cs_method == CS_METHOD_ATOMIC)		// use atomic type
+		*balance_atomic_word += amount;
+	else {
+		current = *balance_word;
+		if (inject_yields)			// stress mode: widen the window between the read and the write
+			sched_yield();
+		*balance_word = current + amount;	// do deposit
+	}
+	return true;
+}
+
+// the transaction run by the delegation server: a negative amount is a deposit
+bool transact(long amount) {
+	return amount < 0 ? deposit(-amount) : withdraw(amount);
+}
+
+// CS_METHOD_OCC: withdraw, or deposit a negative amount, by a double-width CAS of (version, balance)
+// a conflicting commit is counted and retried with the value seen
+bool occ_transact(int tid, long amount)
+{
+	struct versioned_balance seen = atomic_load_explicit(&balance_versioned, memory_order_relaxed), next;
+
+	for (;;) {
+		if (seen.balance < amount)		// if not enough: reject withdrawal
+			return false;
+		next.version = seen.version + 1;
+		next.balance = seen.balance - amount;
+		if (atomic_compare_exchange_weak_explicit(&balance_versioned, &seen, next,
+				memory_order_acq_rel, memory_order_relaxed))
+			return true;
+		++thread_counters[tid].aborts;		// seen holds the current value now
+	}
+}
+
+// move the amount between the accounts under a lock, returns false if not enough
+FORCE_INLINE
+bool transfer(int from, int to, long amount)
+{
+	long available = atomic_load_explicit(&accounts[from].balance, memory_order_relaxed);
+
+	if (available < amount)
+		return false;
+	atomic_store_explicit(&accounts[from].balance, available - amount, memory_order_relaxed);
+	atomic_store_explicit(&accounts[to].balance,
+			atomic_load_explicit(&accounts[to].balance, memory_order_relaxed) + amount, memory_order_relaxed);
+	return true;
+}
+
+// CS_METHOD_OCC: move the amount between the accounts as a small software transaction
+// the source is read without locking, then both versioned locks are taken in the account order;
+// a version changed since the read aborts and retries the transaction, a commit in progress is waited for
+bool stm_transfer(int tid, int from, int to, long amount)
+{
+	int first = from < to ? from : to, second = from < to ? to : from;
+	long version_first, version_second, available;
+
+	for (;;) {
+		version_first = atomic_load_explicit(&accounts[first].lock, memory_order_acquire);
+		version_second = atomic_load_explicit(&accounts[second].lock, memory_order_acquire);
+		if ((version_first | version_second) & 1) {	// a commit is writing: wait, not a conflict yet
+			if (busy_wait_yields)
+				sched_yield();
+			continue;
+		}
+		available = atomic_load_explicit(&accounts[from].balance, memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);	// the balance is read before the version check
+		if (atomic_load_explicit(&accounts[from == first ? first : second].lock, memory_order_relaxed)
+				!= (from == first ? version_first : version_second)) {
+			++thread_counters[tid].aborts;	// the balance read may be torn by a commit
+			continue;
+		}
+		if (available < amount)		// a consistent snapshot: not enough
+			return false;
+		if (!atomic_compare_exchange_strong_explicit(&accounts[first].lock, &version_first, version_first + 1,
+				memory_order_acquire, memory_order_relaxed)) {
+			++thread_counters[tid].aborts;
+			continue;
+		}
+		if (!atomic_compare_exchange_strong_explicit(&accounts[second].lock, &version_second, version_second + 1,
+				memory_order_acquire, memory_order_relaxed)) {
+			atomic_store_explicit(&accounts[first].lock, version_first, memory_order_relaxed);
+			++thread_counters[tid].aborts;	// unlock unchanged
+			continue;
+		}
+		transfer(from, to, amount);	// both locked at the versions read: the snapshot still holds
+		atomic_store_explicit(&accounts[second].lock, version_second + 2, memory_order_release);
+		atomic_store_explicit(&accounts[first].lock, version_first + 2, memory_order_release);
+		return true;
+	}
+}
+
+// -S: take the locks of the stripes of both accounts, the lower stripe first: no deadlock
+FORCE_INLINE
+void stripes_enter(int tid, int from, int to)
+{
+	int first = from % transfer_stripes, second = to % transfer_stripes;
+
+	cs_lock_enter(&stripe_locks[first < second ? first : second], tid);
+	if (first != second)		// both accounts under one stripe: locked once
+		cs_lock_enter(&stripe_locks[first < second ? second : first], tid);
+}
+
+// -S: release the locks of the stripes of both accounts
+FORCE_INLINE
+void stripes_leave(int tid, int from, int to)
+{
+	int first = from % transfer_stripes, second = to % transfer_stripes;
+
+	if (first != second)
+		cs_lock_leave(&stripe_locks[first < second ? second : first], tid);
+	cs_lock_leave(&stripe_locks[first < second ? first : second], tid);
+}
+
+// one transaction of the thread tid, the withdrawn amount is added to total, a deposit to deposited;
+// the time of entering the critical section is stored to acquired unless NULL, a warming one is not tracked
+FORCE_INLINE
+void do_transaction(int tid, long *total, long *acquired, bool warming)
+{
+	long amount;
+	bool depositing, transferring, striped, done;
+	int from = 0, to = 0;
+	struct timespec wait_start, wait_end;
+	long wait;
+
+	amount = draw_amount(tid);		// WITHDRAW_AMOUNT unless a distribution is chosen
+	depositing = deposit_ratio > 0 && (long) (random_next(&thread_counters[tid].amount_state) % 100) < deposit_ratio;
+	transferring = transfer_ratio > 0 && (long) (random_next(&thread_counters[tid].amount_state) % 100) < transfer_ratio;
+	if (transferring) {				// two different accounts
+		from = random_next(&thread_counters[tid].amount_state) % TRANSFER_ACCOUNTS;
+		to = (from + 1 + random_next(&thread_counters[tid].amount_state) % (TRANSFER_ACCOUNTS - 1)) % TRANSFER_ACCOUNTS;
+	}
+	striped = transferring && transfer_stripes > 0;
+
+	if (measure_wait)
+		clock_gettime(CLOCK_MONOTONIC, &wait_start);
+
+	if (striped)					// the accounts only, the balance stays unlocked
+		stripes_enter(tid, from, to);
+	else
+		cs_enter(tid);				// critical section begin
+
+	if (measure_wait) {
+		clock_gettime(CLOCK_MONOTONIC, &wait_end);
+		wait = time_diff_ns(&wait_start, &wait_end);
+		if (wait > wait_max[tid])
+			wait_max[tid] = wait;
+	}
+	if (acquired)
+		*acquired = measure_wait ? wait_end.tv_sec * 1000000000L + wait_end.tv_nsec : time_now_ns();
+	if (cs_method != CS_METHOD_ATOMIC && cs_method != CS_METHOD_OCC && !cs_delegating() && !striped && !warming)
+		track_handoff(tid);			// atomic type, optimistic, delegation and the stripes have no lock to hand over
+									// the warm-up is not tracked: the measured runs start afresh
+
+	if (transferring)				// between the accounts, the balance is not involved
+		done = cs_method == CS_METHOD_OCC ? stm_transfer(tid, from, to, amount) : transfer(from, to, amount);
+	else if (cs_delegating())		// let the server do it, a deposit is a negative withdrawal
+		done = cs_delegate(tid, depositing ? -amount : amount);
+	else if (cs_method == CS_METHOD_OCC)
+		done = occ_transact(tid, depositing ? -amount : amount);
+	else
+		done = depositing ? deposit(amount) : withdraw(amount);
+
+	if (done) {						// success, sum up total
+		if (transferring)
+			++transferred[tid];
+		else if (depositing)
+			deposited[tid] += amount;
+		else
+			*total += amount;
+	}
+	else {	// not enough resources left
+		++rejected[tid];
+		if (verbose > 2)
+			fprintf(stderr, "thread %d: Transaction rejected: %ld, %ld\n", tid, current_balance(), -amount);
+	}
+
+	if (striped)
+		stripes_leave(tid, from, to);
+	else
+		cs_leave(tid);				// critical section end
+}
+
+// helper threads pass the barriers with the workers to begin at the measured start
+static void sync_helper(void)
+{
+	if (do_sync_start)
+		sync_threads(-1, warmup > 0 ? "warm-up" : "transactions");
+	if (warmup > 0)
+		sync_threads(-1, "transactions");
+}
+
+// open loop: transactions arrive at arrival_rate regardless of the completions,
+// latencies are measured from the scheduled arrival (no coordinated omission)
+// otevřená smyčka: transakce přicházejí s danou frekvencí nezávisle na dokončení
+long do_arrivals(int tid)
+{
+	uint64_t random_state = 0x9E3779B97F4A7C15ULL * (tid + 1);	// must not be 0
+	double interval = 1000000000.0 / arrival_rate;		// the mean inter-arrival time [ns]
+	double scheduled;
+	long now, acquired, latency, queueing, i;
+	struct timespec until;
+
+	scheduled = time_now_ns();
+	for (i = 0; i < per_thread && !atomic_load_explicit(&stop_run, memory_order_relaxed); ++i) {
+		// the next arrival; a late thread does not wait, its backlog counts as latency
+		scheduled += arrival_poisson ? -log(1.0 - random_unit(&random_state)) * interval : interval;
+		now = time_now_ns();
+		if (scheduled - now > ARRIVAL_SPIN) {
+			until.tv_sec = (time_t) ((scheduled - ARRIVAL_SPIN) / 1000000000.0);
+			until.tv_nsec = (long) (scheduled - ARRIVAL_SPIN - until.tv_sec * 1000000000.0);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR)
+				;
+		}
+		while (time_now_ns() < scheduled)
+			;
+
+		do_transaction(tid, &withdrawn[tid], &acquired, false);
+		now = time_now_ns();
+		latency = now - (long) scheduled;
+		queueing = acquired - (long) scheduled;
+		++latency_hist[tid][latency_bucket(latency)];
+		++queueing_hist[tid][latency_bucket(queueing)];
+		if (latency > thread_counters[tid].latency_max)		// the buckets keep the lower bounds only
+			thread_counters[tid].latency_max = latency;
+		if (queueing > thread_counters[tid].queueing_max)
+			thread_counters[tid].queueing_max = queueing;
+		++thread_counters[tid].transactions;	// progress for the main thread
+	}
+	return i;
+}
+
 void *do_withdrawals(void *arg)
 {
 	#define	tid	(*(int *)arg)	// thread id from arg
-	long amount;
 	long i;
 
  	if (do_sync_start)
-		sync_threads();			// synchronize start of all threads
-
-	// each thread makes per_thread withdrawals
-	for (i = 0; i < per_thread; ++i) {
+		sync_threads(tid, warmup > 0 ? "warm-up" : "transactions");	// synchronize start of all threads
 
-		amount = WITHDRAW_AMOUNT;		// for the sake of measuring, it’s always the same
+	// warm up caches, CPU frequency and the lock; not measured
+	if (warmup > 0) {
+		for (i = 0; i < warmup; ++i) {
+			do_transaction(tid, &withdrawn_warmup[tid], NULL, true);
+			++thread_counters[tid].warmup_transactions;	// progress for the main thread
+		}
+		sync_threads(tid, "transactions");	// start measuring when all threads are warm
+	}
 
-		cs_enter(tid);					// critical section begin
+	// each thread makes per_thread withdrawals or runs until stopped
+	if (arrival_rate > 0)
+		i = do_arrivals(tid);
+	else
+		for (i = 0; i < per_thread && !atomic_load_explicit(&stop_run, memory_order_relaxed); ++i) {
+			do_transaction(tid, &withdrawn[tid], NULL, false);
+			++thread_counters[tid].transactions;	// progress for the main thread
+		}
 
-		if (withdraw(amount))			// do the transaction
-			withdrawn[tid] += amount;	// success, sum up total
-		else	// not enough resources left
-			if (verbose > 2)
-				fprintf(stderr, "thread %d: Transaction rejected: %ld, %ld\n", tid,
-						cs_method == CS_METHOD_ATOMIC ? balance_atomic : balance, -amount);
+	thread_finished[tid] = true;
+	atomic_fetch_sub(&threads_running, 1);
 
-		cs_leave(tid);					// critical section end
-	}
+	if (getcpu(NULL, (unsigned *) &thread_node[tid]) == -1)
+		thread_node[tid] = -1;
 
 	if (verbose > 1)
 		printf("Thread %2d: transactions performed: %9ld\n", tid, i);
@@ -141,6 +617,670 @@ void *do_withdrawals(void *arg)
 	#undef tid
 }
 
+// the sum of the transactions performed by all threads so far
+long transactions_total(void)
+{
+	long total = 0;
+	int i;
+
+	for (i = 0; i < thread_count; ++i)
+		total += thread_counters[i].transactions;
+	return total;
+}
+
+// the progress of all threads including the warm-up, changes while any thread advances
+long progress_total(void)
+{
+	long total = 0;
+	int i;
+
+	for (i = 0; i < thread_count; ++i)
+		total += thread_counters[i].transactions + thread_counters[i].warmup_transactions;
+	return total;
+}
+
+// sleep for the given time in seconds
+void sleep_seconds(double seconds)
+{
+	struct timespec pause;
+
+	pause.tv_sec = (time_t) seconds;
+	pause.tv_nsec = (long) ((seconds - pause.tv_sec) * 1000000000.0);
+	while (nanosleep(&pause, &pause) == -1 && errno == EINTR)
+		;
+}
+
+// print the aggregate and per-thread throughput every sample_interval ms
+// výpis celkové propustnosti a propustnosti vláken každých sample_interval ms
+void *sample_throughput(void *arg)
+{
+	static long last[MAX_THREADS];		// progress counters at the last sample
+	struct timespec start, next, now, last_time;
+	long count, total;
+	double interval;
+	int i;
+
+	sync_helper();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	next = last_time = start;
+	while (atomic_load(&threads_running) > 0 && !atomic_load_explicit(&stop_run, memory_order_relaxed)) {
+		// absolute wake-up times do not drift with the printing
+		next.tv_nsec += sample_interval % 1000 * 1000000;
+		next.tv_sec += sample_interval / 1000 + next.tv_nsec / 1000000000;
+		next.tv_nsec %= 1000000000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+			;
+		if (atomic_load_explicit(&stop_run, memory_order_relaxed))
+			break;				// the duration elapsed during the sleep
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		interval = time_diff_ns(&last_time, &now) / 1000000000.0;
+		last_time = now;
+
+		for (i = 0, total = 0; i < thread_count; ++i)
+			total += thread_counters[i].transactions - last[i];
+		printf("Sample (ms, transactions/s: total, per thread): %6ld %10.0lf",
+				time_diff_ns(&start, &now) / 1000000, total / interval);
+		for (i = 0; i < thread_count; ++i) {
+			count = thread_counters[i].transactions;
+			printf(" %.0lf", (count - last[i]) / interval);
+			last[i] = count;
+		}
+		printf("\n");
+	}
+	return NULL;
+}
+
+// supervision by the main thread: stop a time-bounded run, detect the steady state
+// dohled hlavního vlákna: ukončení běhu po uplynutí času, detekce ustáleného stavu
+void supervise_run(void)
+{
+	struct timespec start, now, sample_time, steady_start, steady_end;
+	long count, sample_count = 0, steady_start_count = 0, steady_end_count = 0;
+	double elapsed, pause, rate, rate_last = 0, difference;
+	int stable = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	sample_time = steady_start = steady_end = start;
+	while (atomic_load(&threads_running) > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed = time_diff_ns(&start, &now) / 1000000000.0;
+		if (duration > 0 && elapsed >= duration)
+			break;
+		pause = steady_tolerance > 0 ? STEADY_INTERVAL / 1000.0 : duration - elapsed;
+		if (duration > 0 && pause > duration - elapsed)
+			pause = duration - elapsed;
+		sleep_seconds(pause);
+
+		// once a thread finishes the others ramp down, the rest is not steady
+		if (steady_tolerance <= 0 || atomic_load(&threads_running) < thread_count)
+			continue;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		count = transactions_total();
+		rate = (count - sample_count) * 1000000000.0 / time_diff_ns(&sample_time, &now);
+		sample_time = now;
+		sample_count = count;
+
+		if (steady_reached) {		// extend the steady-state window
+			steady_end = now;
+			steady_end_count = count;
+			continue;
+		}
+		difference = rate > rate_last ? rate - rate_last : rate_last - rate;
+		if (rate_last > 0 && difference * 100 <= rate_last * steady_tolerance)
+			++stable;
+		else
+			stable = 0;
+		rate_last = rate;
+		if (stable >= STEADY_INTERVALS) {
+			steady_reached = true;
+			steady_start = steady_end = now;
+			steady_start_count = steady_end_count = count;
+			steady_time = time_diff_ns(&start, &now) / 1000000000.0;
+		}
+	}
+	atomic_store_explicit(&stop_run, true, memory_order_relaxed);
+
+	if (steady_reached && steady_end_count > steady_start_count)
+		steady_rate = (steady_end_count - steady_start_count) * 1000000000.0 / time_diff_ns(&steady_start, &steady_end);
+	else
+		steady_reached = false;		// no complete interval in the steady state
+}
+
+// print the percentiles of the histograms of all threads in microseconds
+// the percentiles are the lower bounds of their buckets, up to about 6 % low; the max is exact
+void report_latency(const char *name, long hist[][LATENCY_BUCKETS], long max)
+{
+	static const double percentiles[] = { 50, 90, 99, 99.9 };
+	long count = 0, sum, bucket_count;
+	int b, i, p = 0;
+
+	for (i = 0; i < thread_count; ++i)
+		for (b = 0; b < LATENCY_BUCKETS; ++b)
+			count += hist[i][b];
+
+	printf("%s in us (p50 p90 p99 p99.9 as bucket lower bounds, exact max):", name);
+	for (b = 0, sum = 0; b < LATENCY_BUCKETS && p < sizeof(percentiles) / sizeof(percentiles[0]); ++b) {
+		for (i = 0, bucket_count = 0; i < thread_count; ++i)
+			bucket_count += hist[i][b];
+		sum += bucket_count;
+		while (count > 0 && p < sizeof(percentiles) / sizeof(percentiles[0])
+				&& sum >= percentiles[p] / 100 * count) {
+			printf(" %.1lf", latency_bucket_value(b) / 1000.0);
+			++p;
+		}
+	}
+	printf(" %.1lf\n", max / 1000.0);
+}
+
+// place the shared data on the NUMA node chosen
+// umístění sdílených dat na zvolený uzel NUMA
+void bind_memory(void)
+{
+	if (cs_mbind(balance_word, sizeof(*balance_word), numa_node) == -1
+			|| cs_mbind(balance_atomic_word, sizeof(*balance_atomic_word), numa_node) == -1
+			|| cs_mbind(withdrawn, thread_count * sizeof(*withdrawn), numa_node) == -1
+			|| cs_mbind(withdrawn_warmup, thread_count * sizeof(*withdrawn_warmup), numa_node) == -1
+			|| cs_mbind(thread_counters, thread_count * sizeof(*thread_counters), numa_node) == -1
+			|| cs_mbind(wait_max, thread_count * sizeof(*wait_max), numa_node) == -1
+			|| (arrival_rate > 0
+				&& (cs_mbind(latency_hist, thread_count * sizeof(*latency_hist), numa_node) == -1
+				|| cs_mbind(queueing_hist, thread_count * sizeof(*queueing_hist), numa_node) == -1))) {
+		perror("mbind");
+		exit(EXIT_FAILURE);
+	}
+	if (cs_bind(numa_node) == -1) {
+		perror("cs_bind: mbind");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// the CPUs the process may run on: a cpuset or taskset(1) restricts them below the online CPUs
+// procesory, na kterých smí proces běžet
+long allowed_cpus(cpu_set_t *cpus)
+{
+	if (sched_getaffinity(0, sizeof(*cpus), cpus) == -1) {
+		perror("sched_getaffinity");
+		exit(EXIT_FAILURE);
+	}
+	return CPU_COUNT(cpus);
+}
+
+// the n-th of the allowed CPUs, cycling over them: their numbers may have gaps
+// n-tý z povolených procesorů, dokola
+int nth_cpu(const cpu_set_t *cpus, long n)
+{
+	int cpu;
+
+	n %= CPU_COUNT(cpus);
+	for (cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		if (CPU_ISSET(cpu, cpus) && n-- == 0)
+			break;
+	return cpu;
+}
+
+// print where the balance is and the share of the transactions done by the threads on its node
+// tisk umístění zůstatku a podílu transakcí vláken na jeho uzlu
+void report_numa(void)
+{
+	int node, local = 0, remote = 0, i;
+	long local_transactions = 0, total = 0;
+
+	if (syscall(__NR_get_mempolicy, &node, NULL, 0, balance_word, MPOL_F_NODE | MPOL_F_ADDR) == -1) {
+		printf("NUMA placement (balance node, local threads, remote threads, local transactions %%): - - - -\n");
+		return;
+	}
+	for (i = 0; i < thread_count; ++i) {
+		total += thread_counters[i].transactions;
+		if (thread_node[i] == node) {
+			++local;
+			local_transactions += thread_counters[i].transactions;
+		}
+		else
+			++remote;
+	}
+	printf("NUMA placement (balance node, local threads, remote threads, local transactions %%): %d %d %d %.1lf\n",
+			node, local, remote, total > 0 ? 100.0 * local_transactions / total : 100.0);
+}
+
+// print the state of the threads and of the lock and abort: no thread progresses
+// výpis stavu vláken a zámku a ukončení: žádné vlákno nepostupuje
+static void report_stall(void)
+{
+	int i;
+
+	fprintf(stderr, "No progress for %ld ms, %d threads running, the last owner %d:\n",
+			watchdog_timeout, atomic_load(&threads_running), owner_last);
+	for (i = 0; i < thread_count; ++i)
+		fprintf(stderr, "Thread %2d: %s, transactions %ld, warm-up transactions %ld\n", i,
+				thread_finished[i] ? "finished" : "running", thread_counters[i].transactions,
+				thread_counters[i].warmup_transactions);
+	fprintf(stderr, "Balance: %ld\n", current_balance());
+	cs_dump(stderr);
+	exit(EXIT_STALLED);
+}
+
+// the watchdog thread: aborts the run when no thread advances within the timeout
+void *watch_progress(void *arg)
+{
+	long last = -1, now;
+
+	while (atomic_load(&threads_running) > 0) {
+		sleep_seconds(watchdog_timeout / 1000.0);
+		if ((now = progress_total()) != last)
+			last = now;
+		else if (atomic_load(&threads_running) > 0)
+			report_stall();
+	}
+	return NULL;
+}
+
+// one side of the store buffering litmus test under the memory-order profile
+FORCE_INLINE
+int litmus_store_load(atomic_int *store, atomic_int *load)
+{
+	switch (cs_memory_order) {
+	case CS_ORDER_ACQ_REL:
+		atomic_store_explicit(store, 1, memory_order_release);
+		return atomic_load_explicit(load, memory_order_acquire);
+	case CS_ORDER_RELAXED:
+		atomic_store_explicit(store, 1, memory_order_relaxed);
+		return atomic_load_explicit(load, memory_order_relaxed);
+	default:
+		atomic_store_explicit(store, 1, memory_order_seq_cst);
+		return atomic_load_explicit(load, memory_order_seq_cst);
+	}
+}
+
+FORCE_INLINE
+void litmus_wait(void)
+{
+	if ((errno = pthread_barrier_wait(&litmus_barrier)) != 0 && errno != PTHREAD_BARRIER_SERIAL_THREAD) {
+		perror("pthread_barrier_wait");
+		exit(3);
+	}
+}
+
+// the litmus test threads: 0 stores x and loads y, 1 stores y and loads x
+void *litmus_thread(void *arg)
+{
+	int id = *(int *) arg;
+	long i, both_zero = 0;
+
+	for (i = 0; i < litmus_iterations; ++i) {
+		litmus_wait();
+		litmus_loaded[id] = id ? litmus_store_load(&litmus_y, &litmus_x) : litmus_store_load(&litmus_x, &litmus_y);
+		litmus_wait();
+		if (id == 0) {			// the other waits at the next start
+			if (litmus_loaded[0] == 0 && litmus_loaded[1] == 0)
+				++both_zero;	// both stores were late: forbidden only by seq_cst
+			atomic_store_explicit(&litmus_x, 0, memory_order_relaxed);
+			atomic_store_explicit(&litmus_y, 0, memory_order_relaxed);
+		}
+	}
+	return (void *) both_zero;
+}
+
+// run the store buffering litmus test under the memory-order profile
+// spuštění testu uspořádání paměti (store buffering)
+int run_litmus(void)
+{
+	pthread_t other;
+	int ids[2] = { 0, 1 };
+	long both_zero;
+
+	if ((errno = pthread_barrier_init(&litmus_barrier, NULL, 2))) {
+		perror("pthread_barrier_init");
+		return 3;
+	}
+	if ((errno = pthread_create(&other, NULL, litmus_thread, &ids[1]))) {
+		perror("pthread_create");
+		return EXIT_FAILURE;
+	}
+	both_zero = (long) litmus_thread(&ids[0]);
+	if ((errno = pthread_join(other, NULL))) {
+		perror("pthread_join");
+		return EXIT_FAILURE;
+	}
+	pthread_barrier_destroy(&litmus_barrier);
+
+	printf("Store buffering litmus test (profile, iterations, both loads 0): %s %ld %ld\n",
+			order_names[cs_memory_order], litmus_iterations, both_zero);
+	if (both_zero > 0 && (cs_memory_order == CS_ORDER_DEFAULT || cs_memory_order == CS_ORDER_SEQ_CST)) {
+		fprintf(stderr, "SEQUENTIAL CONSISTENCY VIOLATED!\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+// read the time stamp counter before the measured code, the earlier instructions are complete
+// the time in ns where there is no time stamp counter
+FORCE_INLINE
+uint64_t tsc_start(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t ticks;
+
+	_mm_lfence();
+	ticks = __rdtsc();
+	_mm_lfence();				// the measured code does not start before the read
+	return ticks;
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+// read the time stamp counter after the measured code, the code is complete
+FORCE_INLINE
+uint64_t tsc_stop(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned aux;
+	uint64_t ticks;
+
+	ticks = __rdtscp(&aux);		// waits for the measured code
+	_mm_lfence();				// the later code does not start before the read
+	return ticks;
+#else
+	return tsc_start();
+#endif
+}
+
+// the nanoseconds per time stamp counter tick, measured against CLOCK_MONOTONIC
+double tsc_ns_per_tick(void)
+{
+	struct timespec time1, time2;
+	uint64_t ticks1, ticks2;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &time1);
+	ticks1 = tsc_start();
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &time2);
+		ns = (time2.tv_sec - time1.tv_sec) * 1e9 + (time2.tv_nsec - time1.tv_nsec);
+	} while (ns < TSC_CALIBRATION);
+	ticks2 = tsc_stop();
+	return ns / (ticks2 - ticks1);
+}
+
+// the ticks of micro_rounds uncontended enter and leave pairs in thread 0, the fastest repetition
+// CS_METHOD_ATOMIC has no lock: the atomic add replacing the critical section is measured
+uint64_t micro_uncontended(void)
+{
+	uint64_t start, ticks, fastest = UINT64_MAX;
+	long i;
+	int repeat;
+
+	for (repeat = 0; repeat < MICRO_REPEATS; ++repeat) {
+		start = tsc_start();
+		if (cs_method == CS_METHOD_ATOMIC)
+			for (i = 0; i < micro_rounds; ++i)
+				atomic_fetch_add(balance_atomic_word, 0);
+		else
+			for (i = 0; i < micro_rounds; ++i) {
+				cs_enter(0);
+				cs_leave(0);
+			}
+		if ((ticks = tsc_stop() - start) < fastest)
+			fastest = ticks;
+	}
+	return fastest;
+}
+
+// the ticks of micro_rounds empty loop iterations, subtracted from the measurements
+uint64_t micro_overhead(void)
+{
+	uint64_t start, ticks, fastest = UINT64_MAX;
+	long i;
+	int repeat;
+
+	for (repeat = 0; repeat < MICRO_REPEATS; ++repeat) {
+		start = tsc_start();
+		for (i = 0; i < micro_rounds; ++i)
+			__asm__ __volatile__ ("" ::: "memory");	// the loop is kept, nothing else
+		if ((ticks = tsc_stop() - start) < fastest)
+			fastest = ticks;
+	}
+	return fastest;
+}
+
+// the ping-pong threads: each takes the lock until it is its turn, then hands the turn over
+void *pingpong_thread(void *arg)
+{
+	int id = *(int *) arg;
+	long done = 0;
+
+	if ((errno = pthread_barrier_wait(&pingpong_barrier)) != 0 && errno != PTHREAD_BARRIER_SERIAL_THREAD) {
+		perror("pthread_barrier_wait");
+		exit(3);
+	}
+	while (done < micro_rounds) {
+		cs_enter(id);
+		if (atomic_load_explicit(&pingpong_turn, memory_order_acquire) == id) {
+			atomic_store_explicit(&pingpong_turn, !id, memory_order_release);
+			++done;
+		}
+		cs_leave(id);
+		if (busy_wait_yields && atomic_load_explicit(&pingpong_turn, memory_order_relaxed) != id) {
+			sched_yield();		// let the other take the lock on a shared CPU
+		}
+	}
+	return NULL;
+}
+
+// the ns of one handoff between two threads pinned to different CPUs if there are more, −1 on failure
+double micro_pingpong(void)
+{
+	pthread_t threads[2];
+	pthread_attr_t attr;
+	cpu_set_t allowed, cpus;
+	int ids[2] = { 0, 1 }, i;
+	struct timespec time1, time2;
+
+	atomic_store(&pingpong_turn, 0);
+	if ((errno = pthread_barrier_init(&pingpong_barrier, NULL, 3))) {
+		perror("pthread_barrier_init");
+		exit(3);
+	}
+	allowed_cpus(&allowed);
+	for (i = 0; i < 2; ++i) {
+		CPU_ZERO(&cpus);
+		CPU_SET(nth_cpu(&allowed, i), &cpus);	// the first two allowed, the same if only one is
+		if ((errno = pthread_attr_init(&attr))
+				|| (errno = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus))
+				|| (errno = pthread_create(&threads[i], &attr, pingpong_thread, &ids[i]))) {
+			perror("pthread_create");
+			exit(EXIT_FAILURE);
+		}
+		pthread_attr_destroy(&attr);
+	}
+	if ((errno = pthread_barrier_wait(&pingpong_barrier)) != 0 && errno != PTHREAD_BARRIER_SERIAL_THREAD) {
+		perror("pthread_barrier_wait");
+		exit(3);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &time1);
+	for (i = 0; i < 2; ++i)
+		if ((errno = pthread_join(threads[i], NULL))) {
+			perror("pthread_join");
+			exit(EXIT_FAILURE);
+		}
+	clock_gettime(CLOCK_MONOTONIC, &time2);
+	pthread_barrier_destroy(&pingpong_barrier);
+	return ((time2.tv_sec - time1.tv_sec) * 1e9 + (time2.tv_nsec - time1.tv_nsec)) / (2.0 * micro_rounds);
+}
+
+// microbenchmark: the uncontended enter and leave, then the handoff between two threads, per method
+// mikrobenchmark: nesoupeřený vstup a výstup, pak předání zámku mezi dvěma vlákny, pro každou metodu
+int run_micro(void)
+{
+	double ns_per_tick = tsc_ns_per_tick();
+	uint64_t overhead = micro_overhead(), ticks;
+	int order = cs_memory_order;
+	cpu_set_t allowed;
+	long cpus_allowed = allowed_cpus(&allowed);
+
+	if (verbose)
+		printf("Time stamp counter (ns per tick, loop overhead ns): %.4lf %.2lf\n",
+				ns_per_tick, overhead * ns_per_tick / micro_rounds);
+	if (cpus_allowed < 2 && !busy_wait_yields)
+		fprintf(stderr, "Busy waiting without -y on %ld CPUs: the waiters spin out their time slices\n", cpus_allowed);
+	cs_thread_count = 2;
+	for (cs_method = CS_METHOD_ATOMIC; cs_method <= CS_METHOD_MQ_SYSV; ++cs_method) {
+		cs_memory_order = order;	// resolved per method by cs_init()
+		cs_init(cs_method);
+		ticks = micro_uncontended();
+		printf("Method %2d (uncontended enter and leave ns, ping-pong handoff ns): %.1lf %.0lf\n", cs_method,
+				(ticks > overhead ? ticks - overhead : 0) * ns_per_tick / micro_rounds, micro_pingpong());
+		fflush(stdout);
+		cs_destroy();
+	}
+	return EXIT_SUCCESS;
+}
+
+// stress mode: run the bursts in child processes and report the lost transactions
+// the children return to run one burst each, the parent exits with the result
+// zátěžový režim: dávky běží v potomcích, rodič vyhodnotí ztracené transakce
+void run_stress(void)
+{
+	uint64_t random_state = (uint64_t) time(NULL) << 16 ^ getpid();
+	long burst, lost = 0, failed = 0;
+	int max_threads = thread_count, verbose_parent, status;
+	pid_t pid;
+
+	for (burst = 0; burst < stress_bursts; ++burst) {
+		// random settings of the burst
+		thread_count = 2 + random_next(&random_state) % (max_threads > 1 ? max_threads - 1 : 1);
+		if (cs_method == CS_METHOD_PETERSON && thread_count > 2)
+			thread_count = 2;
+		pin_threads = random_next(&random_state) & 1;
+		inject_yields = random_next(&random_state) & 1;
+		fflush(stdout);
+		switch ((pid = fork())) {
+		case -1:
+			perror("fork");
+			exit(EXIT_FAILURE);
+		case 0:
+			stress_child = true;
+			verbose_parent = verbose;
+			verbose = 0;
+			if (per_thread == PER_THREAD)
+				per_thread = STRESS_TRANSACTIONS;
+			if (watchdog_timeout == 0)
+				watchdog_timeout = STRESS_WATCHDOG;
+			if (!freopen("/dev/null", "w", stdout)
+					|| (verbose_parent < 2 && !freopen("/dev/null", "w", stderr))) {
+				perror("freopen");		// the errors of the bursts are shown with -vv only
+				exit(EXIT_FAILURE);
+			}
+			return;
+		}
+		if (waitpid(pid, &status, 0) == -1) {
+			perror("waitpid");
+			exit(EXIT_FAILURE);
+		}
+		if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_LOST)
+			++lost;
+		else if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+			++failed;
+		if (verbose > 1)
+			printf("Burst %ld: %d threads%s%s: %s\n", burst, thread_count,
+					pin_threads ? ", pinned" : "", inject_yields ? ", yields injected" : "",
+					!WIFEXITED(status) ? "killed" : WEXITSTATUS(status) == EXIT_LOST ? "lost"
+					: WEXITSTATUS(status) == EXIT_SUCCESS ? "ok" : "failed");
+	}
+	printf("Stress test of method %d (bursts, lost, lost probability, failed): %ld %ld %.4lf %ld\n",
+			cs_method, stress_bursts, lost, (double) lost / stress_bursts, failed);
+	exit(lost ? EXIT_LOST : failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+// the real-time priority: the main thread above the workers, every RT_HIGH_SHARE-th worker high
+FORCE_INLINE
+int rt_priority(int tid)
+{
+	int priority = sched_get_priority_min(rt_policy);
+
+	if (tid < 0)				// the main and the sampler thread stop the run
+		return priority + 2;
+	return priority + (tid % RT_HIGH_SHARE == 0);
+}
+
+// switch the main thread to the real-time policy, the watchdog inherits it
+// a livelocked spinlock is found by the watchdog: the CPU time of a progressing thread is not limited
+// přepnutí hlavního vlákna na plánování reálného času, hlídač je zdědí
+void rt_init(void)
+{
+	struct sched_param param = { .sched_priority = rt_priority(-1) };
+
+	if (watchdog_timeout == 0)
+		watchdog_timeout = RT_WATCHDOG;
+	if ((errno = pthread_setschedparam(pthread_self(), rt_policy, &param))) {
+		perror("pthread_setschedparam");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// print the longest lock waits of the high and the low priority threads
+void report_rt(void)
+{
+	long high = 0, low = 0;
+	int i;
+
+	for (i = 0; i < thread_count; ++i)
+		if (i % RT_HIGH_SHARE == 0) {
+			if (wait_max[i] > high)
+				high = wait_max[i];
+		}
+		else if (wait_max[i] > low)
+			low = wait_max[i];
+	printf("Real-time wait (high-priority max wait us, low-priority max wait us): %.0lf ", high / 1000.0);
+	if (thread_count > 1)
+		printf("%.0lf\n", low / 1000.0);
+	else
+		printf("-\n");
+}
+
+// compute and print the fairness of the lock handoff
+// výpočet a tisk spravedlnosti předávání zámku
+void report_fairness(void)
+{
+	double sum = 0, sum_squares = 0;
+	long min, max, wait_longest = 0;
+	int i;
+
+	// the lock acquisitions count: the amounts vary, deposit or get rejected
+	min = max = thread_counters[0].transactions;
+	for (i = 0; i < thread_count; ++i) {
+		sum += thread_counters[i].transactions;
+		sum_squares += (double) thread_counters[i].transactions * thread_counters[i].transactions;
+		if (thread_counters[i].transactions < min)
+			min = thread_counters[i].transactions;
+		if (thread_counters[i].transactions > max)
+			max = thread_counters[i].transactions;
+		if (wait_max[i] > wait_longest)
+			wait_longest = wait_max[i];
+	}
+
+	// Jain's index: 1 = all threads got the same share, 1/n = one thread got everything
+	printf("Fairness (Jain index, max/min ratio, longest run, max wait us): %.4lf ",
+			sum_squares > 0 ? sum * sum / (thread_count * sum_squares) : 1.0);
+	if (min > 0)
+		printf("%.2lf", (double) max / min);
+	else
+		printf("%s", max > 0 ? "inf" : "1.00");
+	printf(" %ld", owner_run_longest);
+	if (measure_wait)
+		printf(" %.0lf\n", wait_longest / 1000.0);
+	else
+		printf(" -\n");
+
+	// report the threads that got much less than the fair share
+	for (i = 0; i < thread_count; ++i)
+		if (thread_counters[i].transactions * STARVATION_SHARE * thread_count < sum)
+			fprintf(stderr, "Thread %d is starving: transactions %ld of %.0lf\n", i, thread_counters[i].transactions, sum);
+}
+
 int main(int argc, char *argv[])
 {
 	pthread_t tids[MAX_THREADS];
@@ -148,30 +1288,122 @@ int main(int argc, char *argv[])
 	int i;
 	long initial_amount;
 	long total_withdrawn = 0;
+	long total_transactions = 0;
+	long total_rejected = 0;
+	long total_deposited = 0;
+	long total_transferred = 0;
+	long total_aborts = 0;
+	long latency_max = 0;
+	long queueing_max = 0;
+	long accounts_sum = 0;
+	void *layout_data;
+	bool main_syncs;
+	long cpus_allowed;
+	cpu_set_t allowed;
+	pthread_t sampler_tid;
+	pthread_t watchdog_tid;
+	pthread_attr_t attr;
+	struct sched_param param;
+	cpu_set_t cpus;
 
 	// argument(s) evaluation
 	eval_args(argc, argv);
 
-	balance_atomic = balance = initial_amount = thread_count * per_thread;
+	// the litmus test checks the memory orders only, no transactions
+	if (litmus_iterations > 0)
+		return run_litmus();
+
+	// the microbenchmark runs each method itself, without transactions
+	if (micro_rounds > 0)
+		return run_micro();
 
 	if (cs_method != CS_METHOD_ATOMIC && (cs_method < CS_METHOD_MIN || cs_method > CS_METHOD_MAX)) {
 		fprintf(stderr, "No valid CS method specified.\n");
 		return 2;
 	}
+	if (transfer_ratio > 0 && (cs_method == CS_METHOD_ATOMIC || cs_method == CS_METHOD_DELEGATE
+			|| cs_method == CS_METHOD_MQ_POSIX_PAYLOAD || cs_method == CS_METHOD_MQ_POSIX_PRIO)) {
+		fprintf(stderr, "The transfers need a lock or the optimistic method %d\n", CS_METHOD_OCC);
+		return 2;
+	}
+	if (transfer_stripes > 0 && !cs_lock_method(cs_method)) {
+		fprintf(stderr, "The method %d has no lock instances for the stripes\n", cs_method);
+		return 2;
+	}
+
+	// the parent of the stress mode does not return, the children run one burst each
+	if (stress_bursts > 0)
+		run_stress();
+
+	// the wait of the high-priority threads is the result of the real-time mode
+	if (rt_policy != SCHED_OTHER) {
+		measure_wait = true;
+		rt_init();
+	}
+
+	if (duration > 0) {		// time-bounded run: enough balance for any duration
+		per_thread = LONG_MAX;
+		balance_atomic = balance = initial_amount = DURATION_BALANCE;
+	}
+	else {
+		if (funds < 0)			// random amounts: less than the expected demand, some are rejected
+			funds = amount_distribution == AMOUNT_FIXED ? 100 : FUNDS_RANDOM;
+		if (stress_child)		// the last withdrawals compete for the balance: a check-then-act race overdraws
+			funds /= 2;
+		balance_atomic = balance = initial_amount = thread_count * (per_thread + warmup) * amount_mean() * funds / 100;
+	}
+	if ((layout_data = cs_layout_data()) != NULL) {	// the balances next to the lock words or on their own line
+		balance_word = layout_data;
+		balance_atomic_word = (volatile atomic_long *) (balance_word + 1);
+	}
+	*balance_word = balance;
+	atomic_store(balance_atomic_word, balance_atomic);
+	atomic_init(&balance_versioned, ((struct versioned_balance) { 0, balance }));
+	for (i = 0; i < thread_count; ++i)
+		thread_counters[i].amount_state = 0x9E3779B97F4A7C15ULL * (i + 1);	// must not be 0
+	for (i = 0; i < TRANSFER_ACCOUNTS; ++i)
+		atomic_init(&accounts[i].balance, TRANSFER_BALANCE);
 
 	// report initial state
 	if (verbose)
 		printf("%-20s %9ld\n", "The initial balance:", balance);
+	if (verbose > 1)
+		printf("The lock words and the balance (layout, distance in bytes): %s %td\n", layout_names[cs_layout],
+				(char *) balance_word - (char *) (cs_layout == CS_LAYOUT_SHARED ? &cs_shared_line
+				: cs_layout == CS_LAYOUT_PADDED ? &cs_padded_lines : (void *) &locked));
 
 	// release used resources automatically upon exit
 	atexit(release_resources);
  
 	// init for the critical section access control; failure to init = exit
+	cs_thread_count = thread_count;
+	cs_delegate_fn = transact;		// the delegation server runs the withdrawals and the deposits
 	cs_init(cs_method);
+
+	// the stripe locks of the transfers, each on its own cache line
+	for (; stripes_initialized < transfer_stripes; ++stripes_initialized)
+		cs_lock_init(&stripe_locks[stripes_initialized], cs_method);
+
+	// more threads than CPUs: a preempted lock holder stops the spinning waiters
+	cpus_allowed = allowed_cpus(&allowed);
+	if (thread_count > cpus_allowed) {
+		if (verbose)
+			printf("Oversubscribed: %d threads on %ld allowed CPUs\n", thread_count, cpus_allowed);
+		if (cs_busy_waiting() && !busy_wait_yields)
+			fprintf(stderr, "Busy waiting without -y on %ld CPUs: the waiters spin out their time slices\n", cpus_allowed);
+	}
+
+	// move the shared data and the lock to the node chosen before the threads touch them
+	if (numa_node >= 0)
+		bind_memory();
  
+ 	// the main thread waits at the barriers too to start timing the duration or the sampling
+	main_syncs = duration > 0 || steady_tolerance > 0;
+	atomic_store(&threads_running, thread_count);
+
  	// barrier initialization
- 	if (do_sync_start) {
-		if ((errno = pthread_barrier_init(&sync_start_barrier, NULL, thread_count))) {
+ 	if (do_sync_start || warmup > 0) {
+		if ((errno = pthread_barrier_init(&sync_start_barrier, NULL, thread_count + main_syncs + (sample_interval > 0)))) {
  			perror("pthread_barrier_init");
  			return 3;
  		}
@@ -181,17 +1413,54 @@ int main(int argc, char *argv[])
 		time_init();
  
 	// create threads
+	if ((errno = pthread_attr_init(&attr))) {
+		perror("pthread_attr_init");
+		return EXIT_FAILURE;
+	}
+	if (rt_policy != SCHED_OTHER
+			&& ((errno = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED))
+			|| (errno = pthread_attr_setschedpolicy(&attr, rt_policy)))) {
+		perror("pthread_attr_setschedpolicy");
+		return EXIT_FAILURE;
+	}
 	for (i = 0; i < thread_count; ++i) {
 		t[i] = i;
-		if ((errno = pthread_create(&tids[i], NULL, do_withdrawals, &t[i]))) {
+		param.sched_priority = rt_policy != SCHED_OTHER ? rt_priority(i) : 0;
+		if (pin_threads) {		// stress mode: spread the threads over the CPUs, one each
+			CPU_ZERO(&cpus);
+			CPU_SET(nth_cpu(&allowed, i), &cpus);
+		}
+		if ((errno = pthread_attr_setschedparam(&attr, &param))
+				|| (pin_threads && (errno = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus)))
+				|| (errno = pthread_create(&tids[i], &attr, do_withdrawals, &t[i]))) {
 			perror("pthread_create");
 			return EXIT_FAILURE;
 		}
 	}
+	pthread_attr_destroy(&attr);
 
 	if (verbose)
 		printf("Threads started: %d\n", i);
 
+	// the watchdog is not joined: it ends with the process
+	if (watchdog_timeout > 0 && ((errno = pthread_create(&watchdog_tid, NULL, watch_progress, NULL))
+			|| (errno = pthread_detach(watchdog_tid)))) {
+		perror("pthread_create");
+		return EXIT_FAILURE;
+	}
+
+	// the sampler starts with the measuring
+	if (sample_interval > 0 && (errno = pthread_create(&sampler_tid, NULL, sample_throughput, NULL))) {
+		perror("pthread_create");
+		return EXIT_FAILURE;
+	}
+
+	// let the threads work for the duration, then stop them; watch for the steady state
+	if (main_syncs) {
+		sync_helper();
+		supervise_run();
+	}
+
 	// wait for the threads termination
 	for (i = 0; i < thread_count; ++i)
 		if ((errno = pthread_join(tids[i], NULL))) {
@@ -210,32 +1479,112 @@ int main(int argc, char *argv[])
 	CPU_time_system =
 	    (double) (CPU_time2.ru_stime.tv_sec - CPU_time1.ru_stime.tv_sec) + (double) (CPU_time2.ru_stime.tv_usec - CPU_time1.ru_stime.tv_usec) / 1000000.0;
 
+	// the sampler ends after the last worker, not measured
+	if (sample_interval > 0 && (errno = pthread_join(sampler_tid, NULL))) {
+		perror("pthread_join");
+		return EXIT_FAILURE;
+	}
+
 	// print the used time
 	printf("The time spent on the CPU(s) in milliseconds (real user system): "
 	       "%.0lf %.0lf %.0lf\n", real_time * 1000, CPU_time_user * 1000, CPU_time_system * 1000);
 
+	// the context switches show how much the threads blocked or were preempted
+	printf("Context switches (voluntary, involuntary, threads per allowed CPU): %ld %ld %.2lf\n",
+			CPU_time2.ru_nvcsw - CPU_time1.ru_nvcsw, CPU_time2.ru_nivcsw - CPU_time1.ru_nivcsw,
+			(double) thread_count / cpus_allowed);
+
 	for (i = 0; i < thread_count; ++i) {
 		// sum up the total withdrawn amount by each thread
-		total_withdrawn += withdrawn[i];
-		if (verbose)
-			printf("%2d %-17s %9ld\n", i, "thread withdrawn:", withdrawn[i]);
+		total_withdrawn += withdrawn[i] + withdrawn_warmup[i];
+		total_deposited += deposited[i];
+		total_transactions += thread_counters[i].transactions;
+		total_rejected += rejected[i];
+		total_transferred += transferred[i];
+		total_aborts += thread_counters[i].aborts;
+		if (verbose) {
+			printf("%2d %-17s %9ld", i, "thread withdrawn:", withdrawn[i]);
+			if (measure_wait)
+				printf(", max wait %6.0lf us", wait_max[i] / 1000.0);
+			printf("\n");
+		}
 	}
 
-	if (cs_method == CS_METHOD_ATOMIC)	// atomic type was used, update normal
-		balance = balance_atomic;
+	printf("The throughput in transactions per second: %.0lf\n",
+			real_time > 0 ? total_transactions / real_time : 0.0);
+
+	if (total_rejected > 0 || amount_distribution != AMOUNT_FIXED)
+		printf("Rejected transactions (count, %%): %ld %.2lf\n", total_rejected,
+				total_transactions > 0 ? 100.0 * total_rejected / total_transactions : 0.0);
+	if (transfer_ratio > 0 && transfer_stripes > 0)
+		printf("Transfers between %d accounts under %ld striped locks: %ld\n", TRANSFER_ACCOUNTS, transfer_stripes,
+				total_transferred);
+	else if (transfer_ratio > 0)
+		printf("Transfers between %d accounts: %ld\n", TRANSFER_ACCOUNTS, total_transferred);
+	if (cs_method == CS_METHOD_OCC)	// the conflicts retried, the warm-up included
+		printf("Optimistic aborts (count, per committed transaction): %ld %.3lf\n", total_aborts,
+				total_transactions > 0 ? (double) total_aborts / total_transactions : 0.0);
+
+	if (arrival_rate > 0) {
+		printf("The offered load in transactions per second: %.0lf\n", arrival_rate * thread_count);
+		for (i = 0; i < thread_count; ++i) {
+			if (thread_counters[i].latency_max > latency_max)
+				latency_max = thread_counters[i].latency_max;
+			if (thread_counters[i].queueing_max > queueing_max)
+				queueing_max = thread_counters[i].queueing_max;
+		}
+		report_latency("Latency from the arrival", latency_hist, latency_max);
+		report_latency("Queueing for the lock", queueing_hist, queueing_max);
+	}
+
+	if (steady_tolerance > 0) {
+		if (steady_reached)
+			printf("The steady state after %.0lf ms, throughput in transactions per second: %.0lf\n",
+					steady_time * 1000, steady_rate);
+		else
+			printf("The steady state was not reached.\n");
+	}
+
+	report_fairness();
+	cs_report(stdout);
+	report_numa();
+	if (rt_policy != SCHED_OTHER)
+		report_rt();
+
+	balance = current_balance();		// atomic type or optimistic was used, update normal
 
 	// report the total amount withdrawn and the new state
 	if (verbose) {
 		printf("%-20s %9ld\n", "The new balance:", balance);
 		printf("%-20s %9ld\n", "Total withdrawn:", total_withdrawn);
+		if (deposit_ratio > 0)
+			printf("%-20s %9ld\n", "Total deposited:", total_deposited);
 	}
 
 	// check the result and report
-	if (balance != initial_amount - total_withdrawn) {
+	if (balance != initial_amount - total_withdrawn + total_deposited) {
 		fprintf(stderr, "LOST TRANSACTIONS DETECTED!\n"
-				"initial − new != total withdrawn (%ld != %ld)\n",
-				initial_amount - balance, total_withdrawn);
-		return EXIT_FAILURE;
+				"initial − new != total withdrawn − total deposited (%ld != %ld)\n",
+				initial_amount - balance, total_withdrawn - total_deposited);
+		return EXIT_LOST;
+	}
+	if (balance < 0) {
+		fprintf(stderr, "OVERDRAFT DETECTED!\n"
+				"the new balance %ld is negative\n", balance);
+		return EXIT_LOST;
+	}
+	for (i = 0; i < TRANSFER_ACCOUNTS; ++i) {
+		if (accounts[i].balance < 0) {
+			fprintf(stderr, "OVERDRAFT DETECTED!\n"
+					"the account %d has the balance %ld\n", i, (long) accounts[i].balance);
+			return EXIT_LOST;
+		}
+		accounts_sum += accounts[i].balance;
+	}
+	if (accounts_sum != (long) TRANSFER_ACCOUNTS * TRANSFER_BALANCE) {
+		fprintf(stderr, "LOST TRANSFERS DETECTED!\n"
+				"the sum of the accounts %ld != %ld\n", accounts_sum, (long) TRANSFER_ACCOUNTS * TRANSFER_BALANCE);
+		return EXIT_LOST;
 	}
 
 	return EXIT_SUCCESS;
@@ -247,15 +1596,42 @@ void usage(FILE * stream, char *self)
 	fprintf(stream,
 		"Usage:\n"
 		"  %s -h\n"
-		"  %s [-q|-v] -m method [-y] [-c threads] [-t tansactions]\n"
+		"  %s [-q|-v] -m method [-y] [-l] [-c threads] [-t tansactions|-d seconds] [-u warm-up] [-s tolerance] [-i interval] [-r rate [-e]] [-n node] [-p policy] [-k timeout] [-o order] [-L layout] [-b bursts] [-a distribution [-f funds]] [-g deposits] [-j transfers [-S stripes]]\n"
+		"  %s [-o order] -x iterations\n"
+		"  %s [-v] [-y] [-o order] -z rounds\n"
 		"Purpose:\n"
 		"  Simulation of concurrent bank transactions.\n"
 		"Options:\n"
 		"  -h	help\n"
 		"  -m #	the method used for critical section access control (see below)\n"
 		"  -y 	use sched_yield(2) during busy wait (default no)\n"
+		"  -l	measure the lock acquisition wait times (default no)\n"
 		"  -c #	the number of concurrent threads (%u, max. %d)\n"
 		"  -t #	the number of transactions per one thread (%lu)\n"
+		"  -d #	run for the given number of seconds instead of a fixed number of transactions\n"
+		"  -u #	the number of warm-up transactions per one thread, not measured (%ld)\n"
+		"  -s #	detect the steady state: throughput changes within # %% (default off)\n"
+		"  -i #	print the throughput every # milliseconds (default off)\n"
+		"  -r #	open loop: # transaction arrivals per second per thread (default closed loop)\n"
+		"  -e	open loop: Poisson arrivals, exponential inter-arrival times (default constant)\n"
+		"  -n #	place the balance, the lock and the counters on NUMA node # (default first touch)\n"
+		"  -p #	real-time mode: %d = SCHED_FIFO, %d = SCHED_RR at mixed priorities, -k %d unless given (default off)\n"
+		"  -k #	abort with the exit code %d when no thread progresses for # milliseconds (default off)\n"
+		"  -o #	the memory orders of the atomic locks: %d = as written, %d = seq_cst, %d = acquire/release,\n"
+		"    	%d = relaxed tests where legal (default %d)\n"
+		"  -L #	the lock word and the balance: %d = adjacent globals as linked, %d = on one cache line,\n"
+		"    	%d = on separate padded lines (default %d)\n"
+		"  -x #	run # rounds of the store buffering litmus test under the -o orders instead\n"
+		"  -z #	microbenchmark of the methods %d upto %d instead: # uncontended enter and leave pairs,\n"
+		"    	then # lock handoffs each way between two threads pinned to different CPUs\n"
+		"  -a #	the amounts: %d = always %d, %d = uniform, %d = exponential, both with the mean %d, %d = always %d\n"
+		"  -f #	the initial balance in %% of the expected demand (100, %d with random amounts)\n"
+		"  -g #	deposit in # %% of the transactions, withdraw in the rest (default 0)\n"
+		"  -j #	transfer between %d accounts in # %% of the transactions, not with %d and delegation (default 0)\n"
+		"  -S #	lock the transfers by # locks of the -m method striping the accounts, 1 upto %d,\n"
+		"    	instead of the -m lock (methods %d upto %d, %d upto %d, %d; default 0 = the -m lock)\n"
+		"  -b #	stress mode: # short runs with random thread counts (2 upto -c), CPU pinning and\n"
+		"    	yields inside the critical section; exit code %d if any lost transactions (default off)\n"
 		"  -q	do not print account balance state\n"
 		"  -v	print more verbose information\n"
 		"Methods available:\n"
@@ -269,9 +1645,39 @@ void usage(FILE * stream, char *self)
 		"  %2d	System V semaphore\n"
 		"  %2d	POSIX message queue\n"
 		"  %2d	System V message queue\n"
-		, self, self
+		"  %2d	delegation to a server thread via lock-free rings\n"
+		"  %2d	eventfd in the semaphore mode\n"
+		"  %2d	pipe with a token byte\n"
+		"  %2d	UNIX domain socket pair with a token datagram\n"
+		"  %2d	System V semaphore without SEM_UNDO\n"
+		"  %2d	System V semaphore with semtimedop(2)\n"
+		"  %2d	System V semaphore set: all %d account semaphores in one semop(2)\n"
+		"  %2d	POSIX message queue, non-blocking receive spins before blocking\n"
+		"  %2d	POSIX message queue pipeline: withdrawals sent to a server thread\n"
+		"  %2d	POSIX message queue pipeline with thread priorities\n"
+		"  %2d	eventfd token waited for through io_uring\n"
+		"  %2d	NUMA cohort lock: node ticket locks under a global test || xchg\n"
+		"  %2d	POSIX mutex with priority inheritance\n"
+		"  %2d	SW Peterson's algorithm with fences (two threads only)\n"
+		"  %2d	SW filter lock with fences\n"
+		"  %2d	SW Lamport's bakery with fences\n"
+		"  %2d	optimistic: double-width CAS of a versioned balance, versioned account locks for transfers\n"
+		"  %2d	lock elision: Intel RTM transactions, an xchg spinlock after aborts (needs TSX)\n"
+		, self, self, self, self
 		, thread_count, MAX_THREADS
 		, per_thread
+		, warmup
+		, SCHED_FIFO, SCHED_RR, RT_WATCHDOG
+		, EXIT_STALLED
+		, CS_ORDER_DEFAULT, CS_ORDER_SEQ_CST, CS_ORDER_ACQ_REL, CS_ORDER_RELAXED, CS_ORDER_DEFAULT
+		, CS_LAYOUT_DEFAULT, CS_LAYOUT_SHARED, CS_LAYOUT_PADDED, CS_LAYOUT_DEFAULT
+		, CS_METHOD_ATOMIC, CS_METHOD_MQ_SYSV
+		, AMOUNT_FIXED, WITHDRAW_AMOUNT, AMOUNT_UNIFORM, AMOUNT_EXPONENTIAL, AMOUNT_MEAN, AMOUNT_LARGE, AMOUNT_LARGE_VALUE
+		, FUNDS_RANDOM
+		, TRANSFER_ACCOUNTS, CS_METHOD_ATOMIC
+		, TRANSFER_ACCOUNTS
+		, CS_METHOD_LOCKED, CS_METHOD_MQ_SYSV, CS_METHOD_EVENTFD, CS_METHOD_MQ_POSIX_SPIN, CS_METHOD_MUTEX_PI
+		, EXIT_LOST
 		, CS_METHOD_ATOMIC
 		, CS_METHOD_LOCKED
 		, CS_METHOD_XCHG
@@ -282,6 +1688,24 @@ void usage(FILE * stream, char *self)
 		, CS_METHOD_SEM_SYSV
 		, CS_METHOD_MQ_POSIX
 		, CS_METHOD_MQ_SYSV
+		, CS_METHOD_DELEGATE
+		, CS_METHOD_EVENTFD
+		, CS_METHOD_PIPE
+		, CS_METHOD_SOCKETPAIR
+		, CS_METHOD_SEM_SYSV_NOUNDO
+		, CS_METHOD_SEM_SYSV_TIMED
+		, CS_METHOD_SEM_SYSV_MULTI, SEM_SYSV_ACCOUNTS
+		, CS_METHOD_MQ_POSIX_SPIN
+		, CS_METHOD_MQ_POSIX_PAYLOAD
+		, CS_METHOD_MQ_POSIX_PRIO
+		, CS_METHOD_IO_URING
+		, CS_METHOD_COHORT
+		, CS_METHOD_MUTEX_PI
+		, CS_METHOD_PETERSON
+		, CS_METHOD_FILTER
+		, CS_METHOD_BAKERY
+		, CS_METHOD_OCC
+		, CS_METHOD_RTM
 		);
 }
 
@@ -292,7 +1716,7 @@ void eval_args(int argc, char *argv[])
 
 	opterr = 0;		// do not print errors, we'll print it
 	// switches processing
-	while (-1 != (opt = getopt(argc, argv, "hwqvc:t:a:f:s:m:y"))) {
+	while (-1 != (opt = getopt(argc, argv, "hwqvc:t:d:u:i:r:a:f:g:j:s:m:n:p:k:o:L:x:z:b:S:yle"))) {
 		switch (opt) {
 		// -c thread_count
 		case 'c':
@@ -306,6 +1730,146 @@ void eval_args(int argc, char *argv[])
 		case 't':
 			per_thread = strtol(optarg, NULL, 0);
 			break;
+		// -d duration_in_seconds
+		case 'd':
+			duration = strtod(optarg, NULL);
+			if (duration <= 0) {
+				fprintf(stderr, "The duration must be a positive number of seconds\n");
+				exit(2);
+			}
+			break;
+		// -u warm-up_transactions_per_thread
+		case 'u':
+			warmup = strtol(optarg, NULL, 0);
+			break;
+		// -s steady-state_tolerance_in_percent
+		case 's':
+			steady_tolerance = strtod(optarg, NULL);
+			break;
+		// -i sampling_interval_in_milliseconds
+		case 'i':
+			sample_interval = strtol(optarg, NULL, 0);
+			if (sample_interval < 0) {
+				fprintf(stderr, "The sampling interval must not be negative\n");
+				exit(2);
+			}
+			break;
+		// -r arrival_rate_per_thread
+		case 'r':
+			arrival_rate = strtod(optarg, NULL);
+			if (arrival_rate <= 0) {
+				fprintf(stderr, "The arrival rate must be a positive number\n");
+				exit(2);
+			}
+			break;
+		// -n NUMA_node
+		case 'n':
+			numa_node = strtol(optarg, NULL, 0);
+			if (numa_node < 0 || numa_node >= CS_NUMA_NODES - 1) {
+				fprintf(stderr, "The NUMA node is limited to 0 upto %d\n", CS_NUMA_NODES - 2);
+				exit(2);
+			}
+			break;
+		// -p real-time_policy
+		case 'p':
+			rt_policy = strtol(optarg, NULL, 0);
+			if (rt_policy != SCHED_FIFO && rt_policy != SCHED_RR) {
+				fprintf(stderr, "The real-time policy is either %d (SCHED_FIFO) or %d (SCHED_RR)\n", SCHED_FIFO, SCHED_RR);
+				exit(2);
+			}
+			break;
+		// -k watchdog_timeout_in_milliseconds
+		case 'k':
+			watchdog_timeout = strtol(optarg, NULL, 0);
+			if (watchdog_timeout <= 0) {
+				fprintf(stderr, "The watchdog timeout must be a positive number of milliseconds\n");
+				exit(2);
+			}
+			break;
+		// -o memory-order_profile
+		case 'o':
+			cs_memory_order = strtol(optarg, NULL, 0);
+			if (cs_memory_order < CS_ORDER_DEFAULT || cs_memory_order > CS_ORDER_MAX) {
+				fprintf(stderr, "The memory-order profile is limited to %d upto %d\n", CS_ORDER_DEFAULT, CS_ORDER_MAX);
+				exit(2);
+			}
+			break;
+		// -L layout_of_the_lock_and_the_data
+		case 'L':
+			cs_layout = strtol(optarg, NULL, 0);
+			if (cs_layout < CS_LAYOUT_DEFAULT || cs_layout > CS_LAYOUT_MAX) {
+				fprintf(stderr, "The layout is limited to %d upto %d\n", CS_LAYOUT_DEFAULT, CS_LAYOUT_MAX);
+				exit(2);
+			}
+			break;
+		// -x litmus_test_iterations
+		case 'x':
+			litmus_iterations = strtol(optarg, NULL, 0);
+			if (litmus_iterations <= 0) {
+				fprintf(stderr, "The litmus test needs a positive number of rounds\n");
+				exit(2);
+			}
+			break;
+		// -z microbenchmark_rounds
+		case 'z':
+			micro_rounds = strtol(optarg, NULL, 0);
+			if (micro_rounds <= 0) {
+				fprintf(stderr, "The microbenchmark needs a positive number of rounds\n");
+				exit(2);
+			}
+			break;
+		// -a amount_distribution
+		case 'a':
+			amount_distribution = strtol(optarg, NULL, 0);
+			if (amount_distribution < AMOUNT_FIXED || amount_distribution > AMOUNT_MAX) {
+				fprintf(stderr, "The amount distribution is limited to %d upto %d\n", AMOUNT_FIXED, AMOUNT_MAX);
+				exit(2);
+			}
+			break;
+		// -f funds_in_percent
+		case 'f':
+			funds = strtol(optarg, NULL, 0);
+			if (funds < 0) {
+				fprintf(stderr, "The funds must not be negative\n");
+				exit(2);
+			}
+			break;
+		// -g deposit_ratio_in_percent
+		case 'g':
+			deposit_ratio = strtol(optarg, NULL, 0);
+			if (deposit_ratio < 0 || deposit_ratio > 100) {
+				fprintf(stderr, "The deposit ratio is limited to 0 upto 100 %%\n");
+				exit(2);
+			}
+			break;
+		// -j transfer_ratio_in_percent
+		case 'j':
+			transfer_ratio = strtol(optarg, NULL, 0);
+			if (transfer_ratio < 0 || transfer_ratio > 100) {
+				fprintf(stderr, "The transfer ratio is limited to 0 upto 100 %%\n");
+				exit(2);
+			}
+			break;
+		// -S transfer_lock_stripes
+		case 'S':
+			transfer_stripes = strtol(optarg, NULL, 0);
+			if (transfer_stripes < 0 || transfer_stripes > TRANSFER_ACCOUNTS) {
+				fprintf(stderr, "The lock stripes are limited to 0 upto %d\n", TRANSFER_ACCOUNTS);
+				exit(2);
+			}
+			break;
+		// -b stress_bursts
+		case 'b':
+			stress_bursts = strtol(optarg, NULL, 0);
+			if (stress_bursts <= 0) {
+				fprintf(stderr, "The stress mode needs a positive number of bursts\n");
+				exit(2);
+			}
+			break;
+		// Poisson arrivals
+		case 'e':
+			arrival_poisson = true;
+			break;
 		// quiet
 		case 'q':
 			verbose = 0;
@@ -326,6 +1890,10 @@ void eval_args(int argc, char *argv[])
 		case 'y':
 			busy_wait_yields = true;
 			break;
+		// measure the wait for the lock
+		case 'l':
+			measure_wait = true;
+			break;
 		// help
 		case 'h':
 			usage(stdout, argv[0]);
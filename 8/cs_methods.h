@@ -14,17 +14,35 @@
 #define CS_METHOD_SEM_SYSV				7
 #define CS_METHOD_MQ_POSIX				8
 #define CS_METHOD_MQ_SYSV				9
+#define CS_METHOD_DELEGATE				10
+#define CS_METHOD_EVENTFD				11
+#define CS_METHOD_PIPE					12
+#define CS_METHOD_SOCKETPAIR			13
+#define CS_METHOD_SEM_SYSV_NOUNDO		14
+#define CS_METHOD_SEM_SYSV_TIMED		15
+#define CS_METHOD_SEM_SYSV_MULTI		16
+#define CS_METHOD_MQ_POSIX_SPIN			17
+#define CS_METHOD_MQ_POSIX_PAYLOAD		18
+#define CS_METHOD_MQ_POSIX_PRIO			19
+#define CS_METHOD_IO_URING				20
+#define CS_METHOD_COHORT				21
+#define CS_METHOD_MUTEX_PI				22
+#define CS_METHOD_PETERSON				23
+#define CS_METHOD_FILTER				24
+#define CS_METHOD_BAKERY				25
+#define CS_METHOD_OCC					26
+#define CS_METHOD_RTM					27
 
 #define CS_METHOD_MIN					CS_METHOD_LOCKED
-#define CS_METHOD_MAX					CS_METHOD_MQ_SYSV
+#define CS_METHOD_MAX					CS_METHOD_RTM
 #define CS_METHODS_BUSY_WAIT			3
 
 #include <stdbool.h>					// bool
 #include <stdlib.h>						// exit
-#include <stdio.h>						// fprintf
+#include <stdio.h>						// fprintf, snprintf
 // additional includes for critical section access control methods
 #include <stdatomic.h>					// atomic_flag
-#include <sched.h>						// sched_yield(2)
+#include <sched.h>						// sched_yield(2), getcpu(3)
 #include <pthread.h>					// POSIX mutex
 #include <semaphore.h>					// POSIX semaphores
 #include <mqueue.h>						// POSIX message queue
@@ -33,31 +51,177 @@
 #include <sys/ipc.h>					// IPC_PRIVATE, IPC_RMID
 #include <sys/sem.h>					// System V semaphores
 #include <sys/msg.h>					// System V message queue
+#include <sys/eventfd.h>				// eventfd(2)
+#include <sys/socket.h>					// socketpair(2)
+#include <unistd.h>						// pipe(2), read(2), write(2), close(2)
+#include <stdint.h>						// uint64_t
+#include <limits.h>						// CHAR_BIT
 #include <errno.h>						// errno, perror
+#include <sys/mman.h>					// mmap(2)
+#include <sys/syscall.h>				// io_uring_setup(2), io_uring_enter(2), mbind(2)
+#include <linux/mempolicy.h>			// MPOL_BIND, MPOL_MF_MOVE
+#if __has_include(<linux/io_uring.h>)
+#	include <linux/io_uring.h>			// io_uring structures
+#	define CS_HAVE_IO_URING
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#	include <cpuid.h>					// __get_cpuid_count, bit_RTM
+#	include <immintrin.h>				// _xbegin(), _xend(), _xabort(), _xtest()
+#	define CS_HAVE_RTM
+#endif
+
+#define CS_ORDER_DEFAULT				0		// memory-order profiles of the atomic locks: as written per method
+#define CS_ORDER_SEQ_CST				1		// seq_cst everywhere
+#define CS_ORDER_ACQ_REL				2		// acquire tests and exchanges, release stores
+#define CS_ORDER_RELAXED				3		// relaxed tests where legal, acquire exchanges, release stores
+#define CS_ORDER_MAX					CS_ORDER_RELAXED
+
+#define CS_LAYOUT_DEFAULT				0		// placement of the lock words and the data: adjacent globals as linked
+#define CS_LAYOUT_SHARED				1		// the lock word and the data on one cache line
+#define CS_LAYOUT_PADDED				2		// the lock word and the data on separate padded lines
+#define CS_LAYOUT_MAX					CS_LAYOUT_PADDED
+
+#define CS_MAX_THREADS					1024
+#define CS_CACHE_LINE					64
+#define CS_LAYOUT_DATA					16		// the bytes of data cs_layout_data() places
+#define CS_NUMA_NODES					256		// the nodes cs_mbind() can place memory on
 
 bool busy_wait_yields = false;			// set by the main program
+int cs_thread_count = CS_MAX_THREADS;	// set by the main program: the ids used are 0 to count − 1
+bool (*cs_delegate_fn)(long amount);	// set by the main program: the delegated transaction
+int cs_memory_order = CS_ORDER_DEFAULT;	// set by the main program: the profile of the atomic locks
+int cs_layout = CS_LAYOUT_DEFAULT;		// set by the main program: the placement of the lock words
 
 // macros, variable declarations and function definitions for critical section access control
 volatile bool locked;									// CS_METHOD_LOCKED, CS_METHOD_TEST_XCHG
 volatile atomic_flag xchg_locked;						// CS_METHOD_XCHG
-pthread_mutex_t mutex_locked;							// CS_METHOD_MUTEX
-sem_t sem_locked;										// CS_METHOD_SEM_POSIX
+pthread_mutex_t mutex_locked;							// CS_METHOD_MUTEX, CS_METHOD_MUTEX_PI
+struct cs_shared_line {									// CS_LAYOUT_SHARED: the owner gets the data with the lock
+	volatile bool locked;
+	volatile atomic_flag xchg_locked;
+	pthread_mutex_t mutex_locked;
+	char data[CS_LAYOUT_DATA] __attribute__ ((aligned (sizeof(long))));
+} __attribute__ ((aligned (CS_CACHE_LINE))) cs_shared_line;
+_Static_assert(sizeof(struct cs_shared_line) == CS_CACHE_LINE, "the lock words and the data exceed a cache line");
+struct cs_padded_lines {								// CS_LAYOUT_PADDED: the waiters do not disturb the data
+	volatile bool locked __attribute__ ((aligned (CS_CACHE_LINE)));
+	volatile atomic_flag xchg_locked __attribute__ ((aligned (CS_CACHE_LINE)));
+	pthread_mutex_t mutex_locked __attribute__ ((aligned (CS_CACHE_LINE)));
+	char data[CS_LAYOUT_DATA] __attribute__ ((aligned (CS_CACHE_LINE)));
+} cs_padded_lines;
+pthread_mutexattr_t mutex_attr;							// CS_METHOD_MUTEX_PI
 #define SEM_NAME "/cs_methods-sem-st58214"				// CS_METHOD_SEM_POSIX_NAMED
-sem_t *psem_named_locked;								// CS_METHOD_SEM_POSIX_NAMED
-int sem_sys_v_locked;									// CS_METHOD_SEM_SYSV
-struct sembuf sops_wait;								// CS_METHOD_SEM_SYSV
-struct sembuf sops_post;								// CS_METHOD_SEM_SYSV
+#define SEM_SYSV_ACCOUNTS 4								// CS_METHOD_SEM_SYSV_MULTI
+struct timespec sem_sys_v_timeout = { 1, 0 };			// CS_METHOD_SEM_SYSV_TIMED
 #define MQ_POSIX_NAME "/cs_methods-posix_mq-st58214"	// CS_METHOD_MQ_POSIX
 #define MQ_POSIX_MESSAGE "lock"							// CS_METHOD_MQ_POSIX
 #define MQ_POSIX_MESSAGE_LIMIT 4						// CS_METHOD_MQ_POSIX
-mqd_t mq_posix_locked;									// CS_METHOD_MQ_POSIX
-struct mq_attr mq_posix_attr;							// CS_METHOD_MQ_POSIX
-char mq_posix_buffer[MQ_POSIX_MESSAGE_LIMIT + 1];		// CS_METHOD_MQ_POSIX
-struct msgbuf {											// CS_METHOD_MQ_SYSV
+#define MQ_POSIX_SPINS 100								// CS_METHOD_MQ_POSIX_SPIN
+const struct timespec mq_posix_past = { 0, 0 };			// CS_METHOD_MQ_POSIX_SPIN: do not block
+#define MQ_POSIX_REQUESTS 10							// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO: the default msg_max
+#define MQ_POSIX_PRIORITIES 4							// CS_METHOD_MQ_POSIX_PRIO
+struct mq_posix_request {								// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO
+	int id;												// the thread to reply to, −1 = stop the server
+	long amount;										// the withdrawal
+};
+mqd_t mq_posix_locked;									// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO: the requests
+struct mq_attr mq_posix_attr;							// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO
+pthread_t mq_posix_server;								// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO
+sem_t mq_posix_replies[CS_MAX_THREADS];					// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO
+bool mq_posix_results[CS_MAX_THREADS];					// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO
+struct mq_sys_v_msgbuf {									// CS_METHOD_MQ_SYSV: msgbuf is taken by _GNU_SOURCE
 	long int msg_type;
 };
-int mq_sys_v_locked;									// CS_METHOD_MQ_SYSV
-struct msgbuf mq_sys_v_msg;								// CS_METHOD_MQ_SYSV
+struct cs_lock {										// a lock instance of the methods cs_lock_method() accepts
+	int method;											// the method of the instance
+	volatile bool *locked;								// CS_METHOD_LOCKED, _TEST_XCHG: the lock word used
+	volatile atomic_flag *xchg_locked;					// CS_METHOD_XCHG: the lock word used
+	pthread_mutex_t *mutex_locked;						// CS_METHOD_MUTEX, _MUTEX_PI: the mutex used
+	sem_t sem_locked;									// CS_METHOD_SEM_POSIX
+	sem_t *psem_named_locked;							// CS_METHOD_SEM_POSIX_NAMED
+	int fd_locked[2];									// CS_METHOD_EVENTFD, _PIPE, _SOCKETPAIR: the token
+	int sem_sys_v_locked;								// CS_METHOD_SEM_SYSV*: the semaphore set
+	int sem_sys_v_count;								// CS_METHOD_SEM_SYSV*: semaphores in the set
+	struct sembuf sops_wait[SEM_SYSV_ACCOUNTS];			// CS_METHOD_SEM_SYSV*
+	struct sembuf sops_post[SEM_SYSV_ACCOUNTS];			// CS_METHOD_SEM_SYSV*
+	mqd_t mq_posix_locked;								// CS_METHOD_MQ_POSIX, _SPIN: the token queue
+	char mq_posix_buffer[MQ_POSIX_MESSAGE_LIMIT + 1];	// CS_METHOD_MQ_POSIX, _SPIN: the token received
+	int mq_sys_v_locked;								// CS_METHOD_MQ_SYSV: the token queue
+	struct mq_sys_v_msgbuf mq_sys_v_msg;				// CS_METHOD_MQ_SYSV: the token received
+	struct {											// the lock words of an instance, cs_lock_global uses cs_layout
+		volatile bool locked;
+		volatile atomic_flag xchg_locked;
+		pthread_mutex_t mutex_locked;
+	} own;
+} __attribute__ ((aligned (CS_CACHE_LINE)));			// the instances of an array do not share lines
+struct cs_lock cs_lock_global;							// the lock of cs_init(), cs_enter(), cs_leave()
+#define DELEGATE_RING 8									// CS_METHOD_DELEGATE
+struct delegate_ring {									// CS_METHOD_DELEGATE
+	atomic_long head;									// the next request to serve, written by the server
+	atomic_long tail;									// the next free slot, written by the thread
+	long amount[DELEGATE_RING];							// the requests
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct delegate_slot {									// CS_METHOD_DELEGATE
+	atomic_long done;									// the number of completed requests
+	bool result;										// the result of the last request
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct delegate_ring delegate_rings[CS_MAX_THREADS];	// CS_METHOD_DELEGATE
+struct delegate_slot delegate_slots[CS_MAX_THREADS];	// CS_METHOD_DELEGATE
+pthread_t delegate_server;								// CS_METHOD_DELEGATE
+atomic_bool delegate_stop;								// CS_METHOD_DELEGATE
+#ifdef CS_HAVE_IO_URING
+#define IO_URING_ENTRIES 2								// CS_METHOD_IO_URING: one token read in flight
+														// no batching: a thread waits for one token at a time
+														// and must return it before its next wait
+#define IO_URING_WAIT 1									// CS_METHOD_IO_URING: user_data of the token read
+struct io_uring_ring {									// CS_METHOD_IO_URING: one per thread
+	int fd;
+	atomic_uint *sq_head, *sq_tail, *cq_head, *cq_tail;	// shared with the kernel
+	unsigned sq_mask, cq_mask, *sq_array;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr, *cq_ptr;								// the mapped rings
+	size_t sq_size, cq_size, sqes_size;
+	uint64_t wait_value;								// the buffer of the token read
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct io_uring_ring io_uring_rings[CS_MAX_THREADS];	// CS_METHOD_IO_URING
+#endif
+int io_uring_locked;									// CS_METHOD_IO_URING: eventfd with the token
+#define COHORT_NODES 8									// CS_METHOD_COHORT: NUMA nodes told apart, others wrap
+#define COHORT_HANDOFFS 64								// CS_METHOD_COHORT: passes within a node before a global release
+struct cohort_node {									// CS_METHOD_COHORT: the local ticket lock of a node
+	atomic_uint ticket;									// the next ticket to take
+	atomic_uint serving;								// the ticket allowed in
+	bool global_held;									// the cohort owns the global lock, written by the owner only
+	int handoffs;										// consecutive local passes of the global lock
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct cohort_node cohort_nodes[COHORT_NODES];			// CS_METHOD_COHORT
+volatile bool cohort_global __attribute__ ((aligned (CS_CACHE_LINE)));
+														// CS_METHOD_COHORT: released by any thread of the cohort
+struct cohort_thread {									// CS_METHOD_COHORT: one per thread, written on each entry
+	int node;											// the node locked in cs_enter()
+} __attribute__ ((aligned (CS_CACHE_LINE)));			// a shared line would bounce between the nodes
+struct cohort_thread cohort_threads[CS_MAX_THREADS];	// CS_METHOD_COHORT
+atomic_bool peterson_flag[2];							// CS_METHOD_PETERSON: the thread wants to enter
+atomic_int peterson_turn;								// CS_METHOD_PETERSON: the thread to wait
+atomic_int filter_level[CS_MAX_THREADS];				// CS_METHOD_FILTER: the level reached, 0 = not interested
+atomic_int filter_victim[CS_MAX_THREADS];				// CS_METHOD_FILTER: the last thread to enter the level
+atomic_bool bakery_choosing[CS_MAX_THREADS];			// CS_METHOD_BAKERY: taking a number
+atomic_long bakery_number[CS_MAX_THREADS];				// CS_METHOD_BAKERY: the ticket, 0 = not interested
+#define RTM_RETRIES 8									// CS_METHOD_RTM: transactions tried before taking the lock
+#define RTM_ABORT_LOCKED 0xff							// CS_METHOD_RTM: the _xabort() code when the lock is taken
+#define RTM_REASONS 6									// CS_METHOD_RTM: the abort causes told apart
+const char *rtm_reasons[RTM_REASONS] = {				// CS_METHOD_RTM
+	"lock taken", "conflict", "capacity", "debug", "nested", "other"
+};
+struct rtm_stats {										// CS_METHOD_RTM: one per thread
+	long commits;										// the critical sections elided
+	long fallbacks;										// the critical sections run under the lock
+	long aborts[RTM_REASONS];							// the transactions aborted by the cause
+} __attribute__ ((aligned (CS_CACHE_LINE)));
+struct rtm_stats rtm_stats[CS_MAX_THREADS];				// CS_METHOD_RTM
+atomic_bool rtm_locked __attribute__ ((aligned (CS_CACHE_LINE)));
+														// CS_METHOD_RTM: the fallback lock, read by each transaction
 
 
 // note: inline is not used unless asked for optimization
@@ -79,6 +243,48 @@ void cs_enter(int id);
 FORCE_INLINE
 void cs_leave(int id);
 
+// the transactions are run by a server thread, see cs_delegate()
+FORCE_INLINE
+bool cs_delegating(void);
+
+// the method can have more lock instances, see struct cs_lock
+FORCE_INLINE
+bool cs_lock_method(int method);
+
+// initialize the lock instance for the method, the memory orders are those of cs_init()
+void cs_lock_init(struct cs_lock *lock, int method);
+
+// destroy the lock instance
+void cs_lock_destroy(struct cs_lock *lock);
+
+// before entering the critical section of the lock instance
+FORCE_INLINE
+void cs_lock_enter(struct cs_lock *lock, int id);
+
+// after leaving the critical section of the lock instance
+FORCE_INLINE
+void cs_lock_leave(struct cs_lock *lock, int id);
+
+// delegate the transaction to the server thread, returns its result
+FORCE_INLINE
+bool cs_delegate(int id, long amount);
+
+// the waiting threads spin instead of blocking, see busy_wait_yields
+FORCE_INLINE
+bool cs_busy_waiting(void);
+
+// place the lock data of the method on the NUMA node, returns -1 on failure
+int cs_bind(int node);
+
+// print the state of the lock, used when the threads stop progressing
+void cs_dump(FILE *stream);
+
+// print the statistics the method collects, if any
+void cs_report(FILE *stream);
+
+// the CS_LAYOUT_DATA bytes for the protected data placed by cs_layout, NULL = the caller's own globals
+void *cs_layout_data(void);
+
 
 static int cs_method_used = -1;			// method used, initialized in cs_init()
 static bool cs_var_allocated = false;	// successful allocation of variables
@@ -87,30 +293,432 @@ static bool cs_var_allocated = false;	// successful allocation of variables
 // implementation (the funcions are to be inlined, we need them here)
 
 
-// allocate/initialize variables used for the critical section access control
-void cs_init(int method)
+// the server thread of CS_METHOD_DELEGATE: the only one to run the transactions
+static void *delegate_serve(void *arg)
 {
-	cs_method_used = method;
-	switch (cs_method_used) {
-	case CS_METHOD_ATOMIC:
-		return;
+	struct delegate_ring *ring;
+	long head, tail;
+	bool served;
+	int i;
+
+	while (!atomic_load_explicit(&delegate_stop, memory_order_relaxed)) {
+		served = false;
+		for (i = 0; i < cs_thread_count; ++i) {
+			ring = &delegate_rings[i];
+			head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+			tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+											// memory_order_acquire: see the request written before tail
+			for (; head < tail; ++head) {
+				delegate_slots[i].result = cs_delegate_fn(ring->amount[head % DELEGATE_RING]);
+				atomic_store_explicit(&ring->head, head + 1, memory_order_relaxed);
+				atomic_store_explicit(&delegate_slots[i].done, head + 1, memory_order_release);
+											// memory_order_release: publish the result with the completion
+				served = true;
+			}
+		}
+		if (!served && busy_wait_yields) {
+			sched_yield();			// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
+		}
+	}
+	return NULL;
+}
+
+// the server thread of CS_METHOD_MQ_POSIX_PAYLOAD and _PRIO: receives the requests
+static void *mq_posix_serve(void *arg)
+{
+	struct mq_posix_request request;
+
+	for (;;) {
+		if (mq_receive(mq_posix_locked, (char *) &request, sizeof(request), NULL) == -1) {
+											// *msg_prio - NULL: the highest priority comes first anyway
+			if (errno == EINTR)
+				continue;
+			perror("CS_METHOD_MQ_POSIX_PAYLOAD: mq_receive");
+			break;
+		}
+		if (request.id < 0)				// cs_destroy() stops the server
+			break;
+		mq_posix_results[request.id] = cs_delegate_fn(request.amount);
+		sem_post(&mq_posix_replies[request.id]);
+											// the semaphore also publishes the result
+	}
+	return NULL;
+}
+
+#ifdef CS_HAVE_IO_URING
+// set up the io_uring of CS_METHOD_IO_URING and map its rings, returns -1 on failure
+static int io_uring_ring_init(struct io_uring_ring *ring)
+{
+	struct io_uring_params params = { 0 };
+	unsigned char *sq, *cq;
+
+	if ((ring->fd = syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &params)) == -1)
+		return -1;
+	ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	if ((ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+			ring->fd, IORING_OFF_SQ_RING)) == MAP_FAILED)
+		return -1;
+	if ((ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+			ring->fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+		return -1;
+	if ((ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+			ring->fd, IORING_OFF_SQES)) == MAP_FAILED)
+		return -1;
+	sq = ring->sq_ptr;
+	cq = ring->cq_ptr;
+	ring->sq_head = (atomic_uint *) (sq + params.sq_off.head);
+	ring->sq_tail = (atomic_uint *) (sq + params.sq_off.tail);
+	ring->sq_mask = *(unsigned *) (sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+	ring->cq_head = (atomic_uint *) (cq + params.cq_off.head);
+	ring->cq_tail = (atomic_uint *) (cq + params.cq_off.tail);
+	ring->cq_mask = *(unsigned *) (cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+	return 0;
+}
+
+// unmap the rings and close the io_uring of CS_METHOD_IO_URING
+static void io_uring_ring_destroy(struct io_uring_ring *ring)
+{
+	if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ptr != NULL && ring->cq_ptr != MAP_FAILED)
+		munmap(ring->cq_ptr, ring->cq_size);
+	if (ring->sq_ptr != NULL && ring->sq_ptr != MAP_FAILED)
+		munmap(ring->sq_ptr, ring->sq_size);
+	if (ring->fd > 0)
+		close(ring->fd);
+	ring->sqes = ring->cq_ptr = ring->sq_ptr = NULL;
+	ring->fd = 0;
+}
+
+// queue a read of the token eventfd, submitted by the next io_uring_enter(2)
+FORCE_INLINE
+void io_uring_queue(struct io_uring_ring *ring, uint64_t *value, uint64_t user_data)
+{
+	unsigned tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+	struct io_uring_sqe *sqe = &ring->sqes[tail & ring->sq_mask];
+
+	*sqe = (struct io_uring_sqe) { 0 };
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = io_uring_locked;
+	sqe->addr = (uintptr_t) value;
+	sqe->len = sizeof(*value);
+	sqe->user_data = user_data;
+	ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+	atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+											// memory_order_release: the kernel sees the entry with the tail
+}
+
+// reap the completions, returns 1 if the token read completed, −1 if it failed, 0 if it is still pending
+FORCE_INLINE
+int io_uring_reap(struct io_uring_ring *ring)
+{
+	unsigned head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+	int got_token = 0;
+
+	for (; head != tail; ++head)
+		if (ring->cqes[head & ring->cq_mask].user_data == IO_URING_WAIT)
+			got_token = ring->cqes[head & ring->cq_mask].res == sizeof(uint64_t) ? 1 : -1;
+											// res: the bytes read or −errno, e.g. −EINTR, −ECANCELED
+	atomic_store_explicit(ring->cq_head, head, memory_order_release);
+	return got_token;
+}
+
+// take the token: read it through the ring of the thread, again if the read fails
+FORCE_INLINE
+void io_uring_wait(struct io_uring_ring *ring)
+{
+	int got_token;
+
+	io_uring_queue(ring, &ring->wait_value, IO_URING_WAIT);
+	for (;;) {
+		syscall(__NR_io_uring_enter, ring->fd,
+				atomic_load_explicit(ring->sq_tail, memory_order_relaxed)
+				- atomic_load_explicit(ring->sq_head, memory_order_acquire), 1, IORING_ENTER_GETEVENTS, NULL, 0);
+											// no error checking due to performance testing
+											// submit the token read not submitted yet and wait for a completion
+		if ((got_token = io_uring_reap(ring)) > 0)
+			break;
+		if (got_token < 0)					// a failed read took no token: without the check
+											// the thread would enter beside the owner
+			io_uring_queue(ring, &ring->wait_value, IO_URING_WAIT);
+	}
+}
+#endif
+
+// place the pages of the memory on the NUMA node, the pages touched already are moved
+// returns -1 on failure
+static int cs_mbind(const volatile void *addr, size_t size, int node)
+{
+	unsigned long nodemask[CS_NUMA_NODES / (CHAR_BIT * sizeof(unsigned long))] = { 0 };
+	uintptr_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t) addr & ~(page - 1);
+	uintptr_t end = ((uintptr_t) addr + size + page - 1) & ~(page - 1);
+
+	if (node < 0 || node >= CS_NUMA_NODES) {
+		errno = EINVAL;
+		return -1;
+	}
+	nodemask[node / (CHAR_BIT * sizeof(unsigned long))] |= 1UL << node % (CHAR_BIT * sizeof(unsigned long));
+	return syscall(__NR_mbind, start, end - start, MPOL_BIND, nodemask, CS_NUMA_NODES, MPOL_MF_MOVE);
+											// maxnode: the kernel ignores the last bit, node < CS_NUMA_NODES − 1
+											// MPOL_MF_MOVE: migrate the pages shared with other data too
+}
+
+// the test of a spinlock before the exchange under the memory-order profile
+FORCE_INLINE
+bool cs_order_test(volatile bool *lock)
+{
+	switch (cs_memory_order) {
+	case CS_ORDER_SEQ_CST:
+		return atomic_load_explicit(lock, memory_order_seq_cst);
+	case CS_ORDER_ACQ_REL:
+		return atomic_load_explicit(lock, memory_order_acquire);
+	default:
+		return atomic_load_explicit(lock, memory_order_relaxed);
+											// the exchange that follows acquires
+	}
+}
+
+// the exchange taking a spinlock under the memory-order profile, returns the previous state
+FORCE_INLINE
+bool cs_order_exchange(volatile bool *lock)
+{
+	if (cs_memory_order == CS_ORDER_SEQ_CST)
+		return atomic_exchange_explicit(lock, true, memory_order_seq_cst);
+	return atomic_exchange_explicit(lock, true, memory_order_acquire);
+											// the weakest legal: the critical section cannot move up
+}
+
+// the store releasing a spinlock under the memory-order profile
+FORCE_INLINE
+void cs_order_release(volatile bool *lock)
+{
+	if (cs_memory_order == CS_ORDER_SEQ_CST)
+		atomic_store_explicit(lock, false, memory_order_seq_cst);
+	else
+		atomic_store_explicit(lock, false, memory_order_release);
+											// the weakest legal: the critical section cannot move down
+}
+
+// the filter lock of CS_METHOD_FILTER: each of the cs_thread_count − 1 levels holds back one thread
+// software only: no read-modify-write instruction, the fence orders the stores before the loads
+FORCE_INLINE
+void filter_enter(int id)
+{
+	int level, k;
+
+	for (level = 1; level < cs_thread_count; ++level) {
+		atomic_store_explicit(&filter_level[id], level, memory_order_relaxed);
+		atomic_store_explicit(&filter_victim[level], id, memory_order_release);
+		atomic_thread_fence(memory_order_seq_cst);		// the others must see the stores before we read theirs
+		for (k = 0; k < cs_thread_count; ++k) {
+			while (k != id && atomic_load_explicit(&filter_level[k], memory_order_acquire) >= level
+					&& atomic_load_explicit(&filter_victim[level], memory_order_acquire) == id) {
+											// a thread is at this level or higher and we came last: wait
+				if (busy_wait_yields) {
+					sched_yield();
+				}
+			}
+		}
+	}
+}
+
+// Lamport's bakery of CS_METHOD_BAKERY: the lowest ticket enters, the thread id breaks ties
+// software only: no read-modify-write instruction, the fences order the stores before the loads
+FORCE_INLINE
+void bakery_enter(int id)
+{
+	long number, max = 0;
+	int k;
+
+	atomic_store_explicit(&bakery_choosing[id], true, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);			// the others see we are choosing before we read
+	for (k = 0; k < cs_thread_count; ++k)
+		if ((number = atomic_load_explicit(&bakery_number[k], memory_order_relaxed)) > max)
+			max = number;
+	atomic_store_explicit(&bakery_number[id], max + 1, memory_order_relaxed);
+	atomic_store_explicit(&bakery_choosing[id], false, memory_order_release);
+	atomic_thread_fence(memory_order_seq_cst);			// the ticket is visible before we compare
+	for (k = 0; k < cs_thread_count; ++k) {
+		if (k == id)
+			continue;
+		while (atomic_load_explicit(&bakery_choosing[k], memory_order_acquire)) {
+			if (busy_wait_yields) {						// wait for the ticket of k
+				sched_yield();
+			}
+		}
+		while ((number = atomic_load_explicit(&bakery_number[k], memory_order_acquire)) != 0
+				&& (number < max + 1 || (number == max + 1 && k < id))) {
+			if (busy_wait_yields) {						// k is served before us
+				sched_yield();
+			}
+		}
+	}
+}
+
+// the NUMA node the thread runs on, for CS_METHOD_COHORT
+FORCE_INLINE
+int cohort_node_current(void)
+{
+	unsigned cpu, node;
+
+	if (getcpu(&cpu, &node) == -1)		// vDSO: cheap enough for each entry; threads may migrate
+		return 0;
+	return node % COHORT_NODES;
+}
+
+// CS_METHOD_RTM: CPUID leaf 7 reports RTM in EBX bit 11, cleared when TSX is disabled
+static bool rtm_supported(void)
+{
+#ifdef CS_HAVE_RTM
+	unsigned eax, ebx, ecx, edx;
+
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_RTM);
+#else
+	return false;
+#endif
+}
+
+#ifdef CS_HAVE_RTM
+// CS_METHOD_RTM: count the abort of thread id by its cause
+static void rtm_count_abort(int id, unsigned status)
+{
+	int reason;
+
+	if (status & _XABORT_EXPLICIT)			// only rtm_enter() aborts explicitly
+		reason = 0;
+	else if (status & _XABORT_CONFLICT)		// another thread touched the data read or written
+		reason = 1;
+	else if (status & _XABORT_CAPACITY)		// the data do not fit the transactional cache
+		reason = 2;
+	else if (status & _XABORT_DEBUG)
+		reason = 3;
+	else if (status & _XABORT_NESTED)
+		reason = 4;
+	else									// interrupts, system calls, page faults
+		reason = 5;
+	++rtm_stats[id].aborts[reason];
+}
+
+// CS_METHOD_RTM: elide the lock, take it after RTM_RETRIES aborts or a cause retrying cannot help
+// the intrinsics need the rtm target: the function is not inlined into the callers compiled without it
+__attribute__ ((target ("rtm")))
+static void rtm_enter(int id)
+{
+	unsigned status;
+	int retries;
+
+	for (retries = RTM_RETRIES; retries > 0; --retries) {
+		while (atomic_load_explicit(&rtm_locked, memory_order_relaxed)) {
+									// a transaction started now would abort at once
+			if (busy_wait_yields) {
+				sched_yield();
+			}
+		}
+		if ((status = _xbegin()) == _XBEGIN_STARTED) {
+			if (!atomic_load_explicit(&rtm_locked, memory_order_relaxed))
+				return;				// the lock is in the read set now: taking it aborts us
+			_xabort(RTM_ABORT_LOCKED);
+		}
+		rtm_count_abort(id, status);
+		if (!(status & (_XABORT_RETRY | _XABORT_EXPLICIT)))
+			break;					// capacity, debug, nested or a system call: it would abort again
+	}
+	while (atomic_load_explicit(&rtm_locked, memory_order_relaxed)
+			|| atomic_exchange_explicit(&rtm_locked, true, memory_order_acquire)) {
+									// like CS_METHOD_XCHG, tested first: the transactions read the lock
+		if (busy_wait_yields) {
+			sched_yield();
+		}
+	}
+	++rtm_stats[id].fallbacks;
+}
+
+// CS_METHOD_RTM: commit the transaction or release the lock
+__attribute__ ((target ("rtm")))
+static void rtm_leave(int id)
+{
+	if (_xtest()) {
+		_xend();
+		++rtm_stats[id].commits;
+	}
+	else
+		atomic_store_explicit(&rtm_locked, false, memory_order_release);
+}
+#endif
+
+// the method can have more lock instances, see struct cs_lock
+bool cs_lock_method(int method)
+{
+	switch (method) {
 	case CS_METHOD_LOCKED:
 	case CS_METHOD_TEST_XCHG:
-		locked = false;
-		return;
 	case CS_METHOD_XCHG:
-		atomic_flag_clear(&xchg_locked);					// sets atomic_flag object to false
-		return;
 	case CS_METHOD_MUTEX:
-		if ((errno = pthread_mutex_init(&mutex_locked, NULL))) {
+	case CS_METHOD_MUTEX_PI:
+	case CS_METHOD_SEM_POSIX:
+	case CS_METHOD_SEM_POSIX_NAMED:
+	case CS_METHOD_SEM_SYSV:
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
+	case CS_METHOD_MQ_SYSV:
+	case CS_METHOD_EVENTFD:
+	case CS_METHOD_PIPE:
+	case CS_METHOD_SOCKETPAIR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// initialize the lock instance at the lock words set, exit on failure
+static void cs_lock_setup(struct cs_lock *lock, int method)
+{
+	struct mq_attr attr;
+	char name[64];
+
+	lock->method = method;
+	switch (method) {
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+		*lock->locked = false;
+		break;
+	case CS_METHOD_XCHG:
+		atomic_flag_clear(lock->xchg_locked);				// sets atomic_flag object to false
+		break;
+	case CS_METHOD_MUTEX:
+		if ((errno = pthread_mutex_init(lock->mutex_locked, NULL))) {
 															// initialize POSIX mutex
 															// attr - NULL: no need for attributes
 			perror("CS_METHOD_MUTEX: pthread_mutex_init");
 			exit(EXIT_FAILURE);
 		}
 		break;
+	case CS_METHOD_MUTEX_PI:
+		if ((errno = pthread_mutexattr_init(&mutex_attr))
+				|| (errno = pthread_mutexattr_setprotocol(&mutex_attr, PTHREAD_PRIO_INHERIT))) {
+															// PTHREAD_PRIO_INHERIT: the owner runs at the priority
+															// of the highest waiter, no priority inversion
+			perror("CS_METHOD_MUTEX_PI: pthread_mutexattr_setprotocol");
+			exit(EXIT_FAILURE);
+		}
+		errno = pthread_mutex_init(lock->mutex_locked, &mutex_attr);
+		pthread_mutexattr_destroy(&mutex_attr);
+		if (errno) {
+			perror("CS_METHOD_MUTEX_PI: pthread_mutex_init");
+			exit(EXIT_FAILURE);
+		}
+		break;
 	case CS_METHOD_SEM_POSIX:
-		if (sem_init(&sem_locked, 0, 1) == -1) {			// initialize POSIX semaphore
+		if (sem_init(&lock->sem_locked, 0, 1) == -1) {		// initialize POSIX semaphore
 															// pshared - 0: semaphore sharing between threads
 															// value - 1: initialize semaphore counter to 1
 			perror("CS_METHOD_SEM_POSIX: sem_init");
@@ -118,9 +726,12 @@ void cs_init(int method)
 		}
 		break;
 	case CS_METHOD_SEM_POSIX_NAMED:
-		if ((psem_named_locked = sem_open(SEM_NAME, O_CREAT|O_EXCL, S_IRUSR|S_IWUSR, 1)) == SEM_FAILED) {
+		snprintf(name, sizeof(name), "%s-%d-%p", SEM_NAME, (int) getpid(), (void *) lock);
+															// a name per process and instance, unlinked below:
+															// only the handle keeps the semaphore
+		if ((lock->psem_named_locked = sem_open(name, O_CREAT|O_EXCL, S_IRUSR|S_IWUSR, 1)) == SEM_FAILED) {
 															// create and open new named POSIX semaphore
-															// SEM_NAME - name of created semaphore
+															// name - name of created semaphore
 															// O_CREAT: oflag to create semaphore if it does not exist
 															// O_EXCL: oflag to fail if semaphore with same name already exists
 															// mode - S_IRUSR: read right, S_IWUSR: write right
@@ -129,41 +740,54 @@ void cs_init(int method)
 			exit(EXIT_FAILURE);
 		}
 
-		if (sem_unlink(SEM_NAME) == -1) {					// removes the semaphore name immediately
+		if (sem_unlink(name) == -1) {						// removes the semaphore name immediately
 															// named semaphore is destroyed after all other processes close it
 			perror("CS_METHOD_SEM_POSIX_NAMED: sem_unlink");
 			exit(EXIT_FAILURE);
 		}
 		break;
 	case CS_METHOD_SEM_SYSV:
-		if ((sem_sys_v_locked = semget(IPC_PRIVATE, 1, 0600)) == -1) {
-															// key - IPC_PRIVATE: to create private semaphore set for process
-															// nsems - 1: number of created semaphores in set
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+		lock->sem_sys_v_count = method == CS_METHOD_SEM_SYSV_MULTI ? SEM_SYSV_ACCOUNTS : 1;
+		if ((lock->sem_sys_v_locked = semget(IPC_PRIVATE, lock->sem_sys_v_count, 0600)) == -1) {
+															// key - IPC_PRIVATE: a new set each call, no key to share
+															// nsems: number of created semaphores in set, one per account
 															// semflg - 0600: rw for process owner
 			perror("CS_METHOD_SEM_SYSV: semget");
 			exit(EXIT_FAILURE);
 		}
 
-		if (semctl(sem_sys_v_locked, 0, SETVAL, 1) == -1) {	// init first semaphore to 1 using command SETVAL
-			perror("CS_METHOD_SEM_SYSV: semctl init");
-			exit(EXIT_FAILURE);
-		}
+		for (int i = 0; i < lock->sem_sys_v_count; ++i) {
+			if (semctl(lock->sem_sys_v_locked, i, SETVAL, 1) == -1) {
+															// init each semaphore to 1 using command SETVAL
+				perror("CS_METHOD_SEM_SYSV: semctl init");
+				exit(EXIT_FAILURE);
+			}
 
-		sops_wait.sem_num = 0;								// semaphore number - 0: because we have only one semaphore
-		sops_wait.sem_flg = SEM_UNDO;						// operation flag - SEM_UNDO: revert on process failure
-		sops_wait.sem_op = -1;								// semaphore operation - (-1): wait
-		sops_post.sem_num = 0;
-		sops_post.sem_flg = SEM_UNDO;
-		sops_post.sem_op = 1;								// semaphore operation - (1): post
+			lock->sops_wait[i].sem_num = i;					// semaphore number: all the semaphores in one semop(2)
+			lock->sops_wait[i].sem_flg = method == CS_METHOD_SEM_SYSV_NOUNDO ? 0 : SEM_UNDO;
+															// operation flag - SEM_UNDO: revert on process failure
+															// 0: no undo bookkeeping in the kernel
+			lock->sops_wait[i].sem_op = -1;					// semaphore operation - (-1): wait
+			lock->sops_post[i].sem_num = i;
+			lock->sops_post[i].sem_flg = lock->sops_wait[i].sem_flg;
+			lock->sops_post[i].sem_op = 1;					// semaphore operation - (1): post
+		}
 		break;
 	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
 															// mq = POSIX message queue
-		mq_posix_attr.mq_flags = 0;							// no need for O_NONBLOCK
-		mq_posix_attr.mq_maxmsg = 1;						// maximum number of messages in the queue
-		mq_posix_attr.mq_msgsize = MQ_POSIX_MESSAGE_LIMIT;	// maximum message size
-		mq_posix_attr.mq_curmsgs = 0;						// number of current messages in queue, left default
+		attr.mq_flags = 0;									// no need for O_NONBLOCK
+		attr.mq_maxmsg = 1;									// maximum number of messages in the queue
+		attr.mq_msgsize = MQ_POSIX_MESSAGE_LIMIT;			// maximum message size
+		attr.mq_curmsgs = 0;								// number of current messages in queue, left default
 
-		if ((mq_posix_locked = mq_open(MQ_POSIX_NAME, O_CREAT|O_EXCL|O_RDWR, S_IRUSR|S_IWUSR, &mq_posix_attr)) == (mqd_t) -1) {
+		snprintf(name, sizeof(name), "%s-%d-%p", MQ_POSIX_NAME, (int) getpid(), (void *) lock);
+															// a name per process and instance, unlinked below:
+															// only the descriptor keeps the queue
+		if ((lock->mq_posix_locked = mq_open(name, O_CREAT|O_EXCL|O_RDWR, S_IRUSR|S_IWUSR, &attr)) == (mqd_t) -1) {
 															// O_CREAT: oflag to create mq if it does not exist
 															// O_EXCL: oflag to fail if mq with same name already exists
 															// O_RDWR: oflag to open mq for receive and send
@@ -172,77 +796,112 @@ void cs_init(int method)
 			exit(EXIT_FAILURE);
 		}
 
-		if (mq_unlink(MQ_POSIX_NAME) == -1) {				// removes mq name immediately
+		if (mq_unlink(name) == -1) {						// removes mq name immediately
 															// mq is destroyed after all other processes close it
 			perror("CS_METHOD_MQ_POSIX: mq_unlink");
 			exit(EXIT_FAILURE);
 		}
 
-		if (mq_send(mq_posix_locked, MQ_POSIX_MESSAGE, MQ_POSIX_MESSAGE_LIMIT, 0) == -1) {
+		if (mq_send(lock->mq_posix_locked, MQ_POSIX_MESSAGE, MQ_POSIX_MESSAGE_LIMIT, 0) == -1) {
 															// send message to mq to set curmsgs to 1
 															// msg_prio - 0: priority value, needed but not used
-            perror("CS_METHOD_MQ_POSIX: mq_send init");
-            exit(EXIT_FAILURE);
-        }
+			perror("CS_METHOD_MQ_POSIX: mq_send init");
+			exit(EXIT_FAILURE);
+		}
 		break;
 	case CS_METHOD_MQ_SYSV:
-		if ((mq_sys_v_locked = msgget(IPC_PRIVATE, 0600)) == -1) {
+		if ((lock->mq_sys_v_locked = msgget(IPC_PRIVATE, 0600)) == -1) {
 															// svmq = System V message queue
-															// key - IPC_PRIVATE: to create private svmq for process
+															// key - IPC_PRIVATE: a new queue each call, no key to share
 															// msgflg - 0600: rw for process owner
 			perror("CS_METHOD_MQ_SYSV: msgget");
 			exit(EXIT_FAILURE);
 		}
 
-		mq_sys_v_msg.msg_type = 1;							// msg_type must be > 0, msg_text not required
+		lock->mq_sys_v_msg.msg_type = 1;					// msg_type must be > 0, msg_text not required
 
-		if (msgsnd(mq_sys_v_locked, (void *) &mq_sys_v_msg, 0, 0) == -1) {
+		if (msgsnd(lock->mq_sys_v_locked, (void *) &lock->mq_sys_v_msg, 0, 0) == -1) {
 															// msgsz - 0: message size is not needed
 															// msgflg - 0: irrelevant, queue will never fully fill
 			perror("CS_METHOD_MQ_SYSV: msgsnd init");
 			exit(EXIT_FAILURE);
 		}
 		break;
+	case CS_METHOD_EVENTFD:
+		if ((lock->fd_locked[0] = eventfd(1, EFD_SEMAPHORE)) == -1) {
+															// initval - 1: the token is available
+															// EFD_SEMAPHORE: read(2) decrements the counter by 1
+			perror("CS_METHOD_EVENTFD: eventfd");
+			exit(EXIT_FAILURE);
+		}
+		break;
+	case CS_METHOD_PIPE:
+		if (pipe(lock->fd_locked) == -1) {
+			perror("CS_METHOD_PIPE: pipe");
+			exit(EXIT_FAILURE);
+		}
+		if (write(lock->fd_locked[1], "L", 1) != 1) {		// one byte in the pipe is the token
+			perror("CS_METHOD_PIPE: write init");
+			exit(EXIT_FAILURE);
+		}
+		break;
+	case CS_METHOD_SOCKETPAIR:
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, lock->fd_locked) == -1) {
+															// AF_UNIX: local communication
+															// SOCK_DGRAM: message boundaries are kept like in a queue
+			perror("CS_METHOD_SOCKETPAIR: socketpair");
+			exit(EXIT_FAILURE);
+		}
+		if (write(lock->fd_locked[0], "L", 1) != 1) {		// written to one end, read from the other
+			perror("CS_METHOD_SOCKETPAIR: write init");
+			exit(EXIT_FAILURE);
+		}
+		break;
 	default:
-		fprintf(stderr, "Error: The method %d is not defined.\n", cs_method_used);
+		fprintf(stderr, "Error: The method %d has no lock instances.\n", method);
 		exit(EXIT_FAILURE);
 	}
-	cs_var_allocated = true;
 }
 
-// destroy allocated variables used for the critical section access control
-void cs_destroy(void)
+// initialize the lock instance for the method, the memory orders are those of cs_init()
+void cs_lock_init(struct cs_lock *lock, int method)
 {
-	if (!cs_var_allocated)				// if not allocated: nothing to do
-		return;
-	switch (cs_method_used) {
-	case CS_METHOD_ATOMIC:
-	case CS_METHOD_LOCKED:
-	case CS_METHOD_TEST_XCHG:
-	case CS_METHOD_XCHG:
-		break;
+	lock->locked = &lock->own.locked;
+	lock->xchg_locked = &lock->own.xchg_locked;
+	lock->mutex_locked = &lock->own.mutex_locked;
+	cs_lock_setup(lock, method);
+}
+
+// destroy the lock instance
+void cs_lock_destroy(struct cs_lock *lock)
+{
+	switch (lock->method) {
 	case CS_METHOD_MUTEX:
-		if ((errno = pthread_mutex_destroy(&mutex_locked))) {
+	case CS_METHOD_MUTEX_PI:
+		if ((errno = pthread_mutex_destroy(lock->mutex_locked))) {
 											// destroy mutex
 			perror("CS_METHOD_MUTEX: pthread_mutex_destroy");
 		}
 		break;
 	case CS_METHOD_SEM_POSIX:
-		if (sem_destroy(&sem_locked) == -1) {
+		if (sem_destroy(&lock->sem_locked) == -1) {
 											// destroy semaphore
 			perror("CS_METHOD_SEM_POSIX: sem_destroy");
 		}
 		break;
 	case CS_METHOD_SEM_POSIX_NAMED:
-		if (sem_close(psem_named_locked) == -1) {
+		if (sem_close(lock->psem_named_locked) == -1) {
 											// destroy named semaphore
 			perror("CS_METHOD_SEM_POSIX_NAMED: sem_close");
 		}
-		psem_named_locked = SEM_FAILED;		// drop link to semaphore so it can be deleted
+		lock->psem_named_locked = SEM_FAILED;	// drop link to semaphore so it can be deleted
 											// should be already deleted after sem_close when using sem_unlink
 		break;
 	case CS_METHOD_SEM_SYSV:
-		if (semctl(sem_sys_v_locked, 0, IPC_RMID) == -1) {
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+		if (semctl(lock->sem_sys_v_locked, 0, IPC_RMID) == -1) {
 											// immediately remove semaphore set awakening all blocked processes
 											// semnum - 0: index of semaphore
 											// cmd - IPC_RMID: provides functionality above
@@ -250,135 +909,825 @@ void cs_destroy(void)
 		}
 		break;
 	case CS_METHOD_MQ_POSIX:
-		if (mq_close(mq_posix_locked) == -1) {
+	case CS_METHOD_MQ_POSIX_SPIN:
+		if (mq_close(lock->mq_posix_locked) == -1) {
 											// destroy mq
 			perror("CS_METHOD_MQ_POSIX: mq_close");
 		}
 		break;
 	case CS_METHOD_MQ_SYSV:
-		if (msgctl(mq_sys_v_locked, IPC_RMID, NULL) == -1) {
+		if (msgctl(lock->mq_sys_v_locked, IPC_RMID, NULL) == -1) {
 											// immediately remove svmq awakening all waiting reader and writer processes
 											// cmd - IPC_RMID: provides functionality above
 											// buf - NULL: msqid_ds not used
 			perror("CS_METHOD_MQ_SYSV: msgctl destroy");
 		}
 		break;
+	case CS_METHOD_EVENTFD:
+		if (close(lock->fd_locked[0]) == -1) {
+			perror("CS_METHOD_EVENTFD: close");
+		}
+		break;
+	case CS_METHOD_PIPE:
+	case CS_METHOD_SOCKETPAIR:
+		if (close(lock->fd_locked[0]) == -1 || close(lock->fd_locked[1]) == -1) {
+			perror(lock->method == CS_METHOD_PIPE ? "CS_METHOD_PIPE: close" : "CS_METHOD_SOCKETPAIR: close");
+		}
+		break;
 	}
-	cs_var_allocated = false;
 }
 
-// before entering the critical section
-void cs_enter(int id)
+// before entering the critical section of the lock instance
+void cs_lock_enter(struct cs_lock *lock, int id)
 {
-	switch (cs_method_used) {
-	case CS_METHOD_ATOMIC:
-		break;
+	uint64_t eventfd_value;
+	char token;
+	int spins;
+
+	switch (lock->method) {
 	case CS_METHOD_LOCKED:
-		while (locked) {
+		while (*lock->locked) {
 			if (busy_wait_yields) {
 				sched_yield();		// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
 			}
 		}
-		locked = true;
+		*lock->locked = true;
 		break;
 	case CS_METHOD_TEST_XCHG:
-		while (atomic_load_explicit(&locked, memory_order_relaxed) || atomic_exchange_explicit(&locked, true, memory_order_acquire)) {
-									// atomically check if locked
-									// desired - true: value to atomically exchange with
-									// memory_order_relaxed: guaratees only atomicity of operation
-									// memory_order_acquire: ensures sequential consistency of atomics across threads
+		while (cs_order_test(lock->locked) || cs_order_exchange(lock->locked)) {
+									// atomically check if locked, then exchange with true
+									// the memory orders are those of cs_memory_order
 			if (busy_wait_yields) {
 				sched_yield();		// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
 			}
 		}
 		break;
 	case CS_METHOD_XCHG:
-		while (atomic_flag_test_and_set(&xchg_locked)) {	// request lock using atomic operation
+		while (cs_memory_order == CS_ORDER_SEQ_CST ? atomic_flag_test_and_set(lock->xchg_locked)
+				: atomic_flag_test_and_set_explicit(lock->xchg_locked, memory_order_acquire)) {
+															// request lock using atomic operation
 			if (busy_wait_yields) {
 				sched_yield();		// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
 			}
 		}
 		break;
 	case CS_METHOD_MUTEX:
-		errno = pthread_mutex_lock(&mutex_locked);		// no error checking due to performance testing
+	case CS_METHOD_MUTEX_PI:
+		errno = pthread_mutex_lock(lock->mutex_locked);	// no error checking due to performance testing
 														// try to lock mutex
 		break;
 	case CS_METHOD_SEM_POSIX:
-		sem_wait(&sem_locked);							// no error checking due to performance testing
+		sem_wait(&lock->sem_locked);					// no error checking due to performance testing
 														// wait on semaphore
 		break;
 	case CS_METHOD_SEM_POSIX_NAMED:
-		sem_wait(psem_named_locked);					// no error checking due to performance testing
+		sem_wait(lock->psem_named_locked);				// no error checking due to performance testing
 														// wait on named semaphore
 		break;
 	case CS_METHOD_SEM_SYSV:
-		semop(sem_sys_v_locked, &sops_wait, 1);			// no error checking due to performance testing
-														// wait on System V semaphore
-														// 1 to represent number of affected semaphores
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_MULTI:
+		semop(lock->sem_sys_v_locked, lock->sops_wait, lock->sem_sys_v_count);
+														// no error checking due to performance testing
+														// wait on System V semaphore(s)
+														// sem_sys_v_count to represent number of affected semaphores
+		break;
+	case CS_METHOD_SEM_SYSV_TIMED:
+		while (semtimedop(lock->sem_sys_v_locked, lock->sops_wait, 1, &sem_sys_v_timeout) == -1 && errno == EAGAIN)
+			;											// wait on System V semaphore with a timeout
+														// EAGAIN: the timeout expired, wait again
 		break;
 	case CS_METHOD_MQ_POSIX:
-		mq_receive(mq_posix_locked, mq_posix_buffer, MQ_POSIX_MESSAGE_LIMIT, NULL);
+		mq_receive(lock->mq_posix_locked, lock->mq_posix_buffer, MQ_POSIX_MESSAGE_LIMIT, NULL);
 														// no error checking due to performance testing
 														// receive message from mq to act as wait
 														// *msg_prio - NULL: no need for priority
 		break;
+	case CS_METHOD_MQ_POSIX_SPIN:
+		for (spins = 0; spins < MQ_POSIX_SPINS; ++spins) {
+			if (mq_timedreceive(lock->mq_posix_locked, lock->mq_posix_buffer, MQ_POSIX_MESSAGE_LIMIT, NULL,
+					&mq_posix_past) != -1)
+				break;									// got the token without blocking
+														// mq_posix_past: fail with ETIMEDOUT at once if empty
+			if (busy_wait_yields) {
+				sched_yield();		// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
+			}
+		}
+		if (spins == MQ_POSIX_SPINS)
+			mq_receive(lock->mq_posix_locked, lock->mq_posix_buffer, MQ_POSIX_MESSAGE_LIMIT, NULL);
+														// no error checking due to performance testing
+														// spinning did not help: block
+		break;
 	case CS_METHOD_MQ_SYSV:
-		msgrcv(mq_sys_v_locked, (void *) &mq_sys_v_msg, 0, 0, 0);
+		msgrcv(lock->mq_sys_v_locked, (void *) &lock->mq_sys_v_msg, 0, 0, 0);
 														// no error checking due to performance testing
 														// msgsz - 0: message size is not needed
 														// msgtyp - 0: first message in queue shall be received
 														// msgflg - 0: when no message is present, wait/block thread
 		break;
+	case CS_METHOD_EVENTFD:
+		read(lock->fd_locked[0], &eventfd_value, sizeof(eventfd_value));
+														// no error checking due to performance testing
+														// blocks while the counter is 0, then decrements it
+		break;
+	case CS_METHOD_PIPE:
+		read(lock->fd_locked[0], &token, 1);			// no error checking due to performance testing
+														// take the token byte, block if the pipe is empty
+		break;
+	case CS_METHOD_SOCKETPAIR:
+		read(lock->fd_locked[1], &token, 1);
+														// no error checking due to performance testing
+														// take the token datagram, block if there is none
+		break;
 	}
 }
 
-// after leaving the critical section
-void cs_leave(int id)
+// after leaving the critical section of the lock instance
+void cs_lock_leave(struct cs_lock *lock, int id)
 {
-	switch (cs_method_used) {
-	case CS_METHOD_ATOMIC:
-		break;
+	static const uint64_t eventfd_one = 1;
+
+	switch (lock->method) {
 	case CS_METHOD_LOCKED:
-		locked = false;
+		*lock->locked = false;
 		break;
 	case CS_METHOD_TEST_XCHG:
-		atomic_store_explicit(&locked, false, memory_order_release);
-									// desired - false: value to atomically exchange with
-									// memory_order_release: ensures sequential consistency of atomics across threads
+		cs_order_release(lock->locked);	// the memory order is that of cs_memory_order
 		break;
 	case CS_METHOD_XCHG:
-		atomic_flag_clear(&xchg_locked);						// sets atomic_flag object to false
+		if (cs_memory_order == CS_ORDER_SEQ_CST)
+			atomic_flag_clear(lock->xchg_locked);				// sets atomic_flag object to false
+		else
+			atomic_flag_clear_explicit(lock->xchg_locked, memory_order_release);
 		break;
 	case CS_METHOD_MUTEX:
-		errno = pthread_mutex_unlock(&mutex_locked);			// no error checking due to performance testing
+	case CS_METHOD_MUTEX_PI:
+		errno = pthread_mutex_unlock(lock->mutex_locked);		// no error checking due to performance testing
 																// unlock mutex
 		break;
 	case CS_METHOD_SEM_POSIX:
-		sem_post(&sem_locked);									// no error checking due to performance testing
+		sem_post(&lock->sem_locked);							// no error checking due to performance testing
 																// post on semaphore
 		break;
 	case CS_METHOD_SEM_POSIX_NAMED:
-		sem_post(psem_named_locked);							// no error checking due to performance testing
+		sem_post(lock->psem_named_locked);						// no error checking due to performance testing
 																// post on named semaphore
 		break;
 	case CS_METHOD_SEM_SYSV:
-		semop(sem_sys_v_locked, &sops_post, 1);					// no error checking due to performance testing
-																// post on System V semaphore
-																// 1 to represent number of affected semaphores
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+		semop(lock->sem_sys_v_locked, lock->sops_post, lock->sem_sys_v_count);
+																// no error checking due to performance testing
+																// post on System V semaphore(s)
+																// sem_sys_v_count to represent number of affected semaphores
 		break;
 	case CS_METHOD_MQ_POSIX:
-		mq_send(mq_posix_locked, MQ_POSIX_MESSAGE, MQ_POSIX_MESSAGE_LIMIT, 0);
+	case CS_METHOD_MQ_POSIX_SPIN:
+		mq_send(lock->mq_posix_locked, MQ_POSIX_MESSAGE, MQ_POSIX_MESSAGE_LIMIT, 0);
 																// no error checking due to performance testing
 																// send message to mq to act as post
 																// msg_prio - 0: priority value, needed but not used
 		break;
 	case CS_METHOD_MQ_SYSV:
-		msgsnd(mq_sys_v_locked, (void *) &mq_sys_v_msg, 0, 0);
+		msgsnd(lock->mq_sys_v_locked, (void *) &lock->mq_sys_v_msg, 0, 0);
 																// no error checking due to performance testing
 																// msgsz - 0: message size is not needed
 																// msgflg - 0: irrelevant, queue will never fully fill
 		break;
+	case CS_METHOD_EVENTFD:
+		write(lock->fd_locked[0], &eventfd_one, sizeof(eventfd_one));
+																// no error checking due to performance testing
+																// increment the counter to return the token
+		break;
+	case CS_METHOD_PIPE:
+		write(lock->fd_locked[1], "L", 1);						// no error checking due to performance testing
+																// return the token byte
+		break;
+	case CS_METHOD_SOCKETPAIR:
+		write(lock->fd_locked[0], "L", 1);						// no error checking due to performance testing
+																// return the token datagram
+		break;
+	}
+}
+
+// allocate/initialize variables used for the critical section access control
+void cs_init(int method)
+{
+	char name[64];
+
+	cs_method_used = method;
+	switch (cs_layout) {
+	case CS_LAYOUT_SHARED:
+		cs_lock_global.locked = &cs_shared_line.locked;
+		cs_lock_global.xchg_locked = &cs_shared_line.xchg_locked;
+		cs_lock_global.mutex_locked = &cs_shared_line.mutex_locked;
+		break;
+	case CS_LAYOUT_PADDED:
+		cs_lock_global.locked = &cs_padded_lines.locked;
+		cs_lock_global.xchg_locked = &cs_padded_lines.xchg_locked;
+		cs_lock_global.mutex_locked = &cs_padded_lines.mutex_locked;
+		break;
+	default:
+		cs_lock_global.locked = &locked;
+		cs_lock_global.xchg_locked = &xchg_locked;
+		cs_lock_global.mutex_locked = &mutex_locked;
+		break;
+	}
+	if (cs_memory_order == CS_ORDER_DEFAULT)	// the orders written originally for each method
+		cs_memory_order = cs_method_used == CS_METHOD_XCHG ? CS_ORDER_SEQ_CST : CS_ORDER_RELAXED;
+	switch (cs_method_used) {
+	case CS_METHOD_ATOMIC:
+	case CS_METHOD_OCC:									// optimistic: the transaction commits itself
+		return;
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+	case CS_METHOD_XCHG:
+	case CS_METHOD_MUTEX:
+	case CS_METHOD_MUTEX_PI:
+	case CS_METHOD_SEM_POSIX:
+	case CS_METHOD_SEM_POSIX_NAMED:
+	case CS_METHOD_SEM_SYSV:
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
+	case CS_METHOD_MQ_SYSV:
+	case CS_METHOD_EVENTFD:
+	case CS_METHOD_PIPE:
+	case CS_METHOD_SOCKETPAIR:
+		cs_lock_setup(&cs_lock_global, method);			// the lock words placed by cs_layout
+		break;
+	case CS_METHOD_COHORT:
+		for (int i = 0; i < COHORT_NODES; ++i)
+			cohort_nodes[i] = (struct cohort_node) { 0 };
+		atomic_init(&cohort_global, false);
+		return;
+	case CS_METHOD_RTM:
+		if (!rtm_supported()) {
+			fprintf(stderr, "CS_METHOD_RTM: unsupported, the CPU has no RTM or TSX is disabled.\n");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < cs_thread_count; ++i)
+			rtm_stats[i] = (struct rtm_stats) { 0 };
+		atomic_init(&rtm_locked, false);
+		return;
+	case CS_METHOD_PETERSON:
+		if (cs_thread_count > 2) {
+			fprintf(stderr, "CS_METHOD_PETERSON: limited to two threads.\n");
+			exit(EXIT_FAILURE);
+		}
+		atomic_init(&peterson_flag[0], false);
+		atomic_init(&peterson_flag[1], false);
+		atomic_init(&peterson_turn, 0);
+		return;
+	case CS_METHOD_FILTER:
+		for (int i = 0; i < cs_thread_count; ++i) {
+			atomic_init(&filter_level[i], 0);
+			atomic_init(&filter_victim[i], -1);
+		}
+		return;
+	case CS_METHOD_BAKERY:
+		for (int i = 0; i < cs_thread_count; ++i) {
+			atomic_init(&bakery_choosing[i], false);
+			atomic_init(&bakery_number[i], 0);
+		}
+		return;
+	case CS_METHOD_MQ_POSIX_PAYLOAD:
+	case CS_METHOD_MQ_POSIX_PRIO:
+															// mq = POSIX message queue
+															// pipeline: the requests go to a server, no lock token
+		mq_posix_attr.mq_flags = 0;							// no need for O_NONBLOCK
+		mq_posix_attr.mq_maxmsg = MQ_POSIX_REQUESTS;		// maximum number of messages in the queue
+		mq_posix_attr.mq_msgsize = sizeof(struct mq_posix_request);
+															// maximum message size
+		mq_posix_attr.mq_curmsgs = 0;						// number of current messages in queue, left default
+
+		snprintf(name, sizeof(name), "%s-%d", MQ_POSIX_NAME, (int) getpid());
+															// a name per process, unlinked below
+		if ((mq_posix_locked = mq_open(name, O_CREAT|O_EXCL|O_RDWR, S_IRUSR|S_IWUSR, &mq_posix_attr)) == (mqd_t) -1) {
+															// O_CREAT: oflag to create mq if it does not exist
+															// O_EXCL: oflag to fail if mq with same name already exists
+															// O_RDWR: oflag to open mq for receive and send
+															// mode - S_IRUSR: read right, S_IWUSR: write right
+			perror("CS_METHOD_MQ_POSIX: mq_open");
+			exit(EXIT_FAILURE);
+		}
+
+		if (mq_unlink(name) == -1) {						// removes mq name immediately
+															// mq is destroyed after all other processes close it
+			perror("CS_METHOD_MQ_POSIX: mq_unlink");
+			exit(EXIT_FAILURE);
+		}
+
+		for (int i = 0; i < cs_thread_count; ++i)
+			if (sem_init(&mq_posix_replies[i], 0, 0) == -1) {
+															// value - 0: the reply is not ready
+				perror("CS_METHOD_MQ_POSIX_PAYLOAD: sem_init");
+				exit(EXIT_FAILURE);
+			}
+		if ((errno = pthread_create(&mq_posix_server, NULL, mq_posix_serve, NULL))) {
+			perror("CS_METHOD_MQ_POSIX_PAYLOAD: pthread_create");
+			exit(EXIT_FAILURE);
+		}
+		break;
+	case CS_METHOD_DELEGATE:
+		for (int i = 0; i < cs_thread_count; ++i) {
+			atomic_init(&delegate_rings[i].head, 0);
+			atomic_init(&delegate_rings[i].tail, 0);
+			atomic_init(&delegate_slots[i].done, 0);
+		}
+		atomic_store(&delegate_stop, false);
+		if ((errno = pthread_create(&delegate_server, NULL, delegate_serve, NULL))) {
+															// the server thread owns the shared data
+			perror("CS_METHOD_DELEGATE: pthread_create");
+			exit(EXIT_FAILURE);
+		}
+		break;
+	case CS_METHOD_IO_URING:
+#ifdef CS_HAVE_IO_URING
+		if ((io_uring_locked = eventfd(1, EFD_SEMAPHORE)) == -1) {
+															// the token like in CS_METHOD_EVENTFD
+			perror("CS_METHOD_IO_URING: eventfd");
+			exit(EXIT_FAILURE);
+		}
+		if (io_uring_ring_init(&io_uring_rings[0]) == -1) {	// check the support, each thread sets up its own
+															// ring in cs_enter(): the completions are run
+															// as the task work of the thread that created it
+			perror("CS_METHOD_IO_URING: io_uring_setup");
+			io_uring_ring_destroy(&io_uring_rings[0]);
+			close(io_uring_locked);
+			exit(EXIT_FAILURE);
+		}
+		io_uring_ring_destroy(&io_uring_rings[0]);
+		break;
+#else
+		fprintf(stderr, "CS_METHOD_IO_URING: io_uring is unsupported by the system headers.\n");
+		exit(EXIT_FAILURE);
+#endif
+	default:
+		fprintf(stderr, "Error: The method %d is not defined.\n", cs_method_used);
+		exit(EXIT_FAILURE);
+	}
+	cs_var_allocated = true;
+}
+
+// destroy allocated variables used for the critical section access control
+void cs_destroy(void)
+{
+	struct mq_posix_request stop = { -1, 0 };	// CS_METHOD_MQ_POSIX_PAYLOAD, _PRIO: stops the server
+
+	if (!cs_var_allocated)				// if not allocated: nothing to do
+		return;
+	switch (cs_method_used) {
+	case CS_METHOD_ATOMIC:
+	case CS_METHOD_OCC:
+	case CS_METHOD_COHORT:
+	case CS_METHOD_PETERSON:
+	case CS_METHOD_FILTER:
+	case CS_METHOD_BAKERY:
+	case CS_METHOD_RTM:
+		break;
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+	case CS_METHOD_XCHG:
+	case CS_METHOD_MUTEX:
+	case CS_METHOD_MUTEX_PI:
+	case CS_METHOD_SEM_POSIX:
+	case CS_METHOD_SEM_POSIX_NAMED:
+	case CS_METHOD_SEM_SYSV:
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
+	case CS_METHOD_MQ_SYSV:
+	case CS_METHOD_EVENTFD:
+	case CS_METHOD_PIPE:
+	case CS_METHOD_SOCKETPAIR:
+		cs_lock_destroy(&cs_lock_global);
+		break;
+	case CS_METHOD_MQ_POSIX_PAYLOAD:
+	case CS_METHOD_MQ_POSIX_PRIO:
+		if (mq_send(mq_posix_locked, (char *) &stop, sizeof(stop), 0) == -1) {
+											// the threads are done, the server gets it last
+			perror("CS_METHOD_MQ_POSIX_PAYLOAD: mq_send stop");
+		}
+		else if ((errno = pthread_join(mq_posix_server, NULL))) {
+			perror("CS_METHOD_MQ_POSIX_PAYLOAD: pthread_join");
+		}
+		for (int i = 0; i < cs_thread_count; ++i)
+			sem_destroy(&mq_posix_replies[i]);
+		if (mq_close(mq_posix_locked) == -1) {
+											// destroy mq
+			perror("CS_METHOD_MQ_POSIX_PAYLOAD: mq_close");
+		}
+		break;
+	case CS_METHOD_DELEGATE:
+		atomic_store(&delegate_stop, true);
+		if ((errno = pthread_join(delegate_server, NULL))) {
+											// wait for the server to finish
+			perror("CS_METHOD_DELEGATE: pthread_join");
+		}
+		break;
+	case CS_METHOD_IO_URING:
+#ifdef CS_HAVE_IO_URING
+		for (int i = 0; i < cs_thread_count; ++i)
+			io_uring_ring_destroy(&io_uring_rings[i]);
+		if (close(io_uring_locked) == -1) {
+			perror("CS_METHOD_IO_URING: close");
+		}
+#endif
+		break;
+	}
+	cs_var_allocated = false;
+}
+
+// before entering the critical section
+void cs_enter(int id)
+{
+	struct cohort_node *cohort;
+	unsigned ticket;
+
+	switch (cs_method_used) {
+	case CS_METHOD_ATOMIC:
+	case CS_METHOD_OCC:
+		break;
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+	case CS_METHOD_XCHG:
+	case CS_METHOD_MUTEX:
+	case CS_METHOD_MUTEX_PI:
+	case CS_METHOD_SEM_POSIX:
+	case CS_METHOD_SEM_POSIX_NAMED:
+	case CS_METHOD_SEM_SYSV:
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
+	case CS_METHOD_MQ_SYSV:
+	case CS_METHOD_EVENTFD:
+	case CS_METHOD_PIPE:
+	case CS_METHOD_SOCKETPAIR:
+		cs_lock_enter(&cs_lock_global, id);
+		break;
+	case CS_METHOD_MQ_POSIX_PAYLOAD:						// the server does the critical section, see cs_delegate()
+	case CS_METHOD_MQ_POSIX_PRIO:
+		break;
+	case CS_METHOD_DELEGATE:								// the server does the critical section, see cs_delegate()
+		break;
+	case CS_METHOD_IO_URING:
+#ifdef CS_HAVE_IO_URING
+		if (io_uring_rings[id].fd == 0 && io_uring_ring_init(&io_uring_rings[id]) == -1) {
+														// the first entry of the thread
+			perror("CS_METHOD_IO_URING: io_uring_setup");
+			exit(EXIT_FAILURE);
+		}
+		io_uring_wait(&io_uring_rings[id]);
+#endif
+		break;
+	case CS_METHOD_COHORT:
+		cohort = &cohort_nodes[cohort_threads[id].node = cohort_node_current()];
+		ticket = atomic_fetch_add_explicit(&cohort->ticket, 1, memory_order_relaxed);
+		while (atomic_load_explicit(&cohort->serving, memory_order_acquire) != ticket) {
+									// wait for the local lock of the node
+									// memory_order_acquire: see global_held and the data of the previous owner
+			if (busy_wait_yields) {
+				sched_yield();		// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
+			}
+		}
+		if (cohort->global_held)	// passed within the node: the global lock is ours already
+			break;
+		while (cs_order_test(&cohort_global) || cs_order_exchange(&cohort_global)) {
+									// the first of the cohort takes the global lock, test || xchg
+			if (busy_wait_yields) {
+				sched_yield();
+			}
+		}
+		cohort->global_held = true;
+		cohort->handoffs = 0;
+		break;
+	case CS_METHOD_PETERSON:
+		atomic_store_explicit(&peterson_flag[id], true, memory_order_relaxed);
+		atomic_store_explicit(&peterson_turn, !id, memory_order_release);
+									// let the other go first; memory_order_release: the other
+									// sees our last critical section when it reads the turn
+		atomic_thread_fence(memory_order_seq_cst);
+									// the stores before the loads, the only ordering x86 does not keep
+		while (atomic_load_explicit(&peterson_flag[!id], memory_order_acquire)
+				&& atomic_load_explicit(&peterson_turn, memory_order_acquire) == !id) {
+			if (busy_wait_yields) {
+				sched_yield();		// causes the calling thread to relinquish the CPU, thread is moved to the end of queue
+			}
+		}
+		break;
+	case CS_METHOD_FILTER:
+		filter_enter(id);
+		break;
+	case CS_METHOD_BAKERY:
+		bakery_enter(id);
+		break;
+	case CS_METHOD_RTM:
+#ifdef CS_HAVE_RTM
+		rtm_enter(id);
+#endif
+		break;
+	}
+}
+
+// after leaving the critical section
+void cs_leave(int id)
+{
+	static const uint64_t eventfd_one = 1;
+	struct cohort_node *cohort;
+	unsigned next;
+
+	switch (cs_method_used) {
+	case CS_METHOD_ATOMIC:
+	case CS_METHOD_OCC:
+		break;
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+	case CS_METHOD_XCHG:
+	case CS_METHOD_MUTEX:
+	case CS_METHOD_MUTEX_PI:
+	case CS_METHOD_SEM_POSIX:
+	case CS_METHOD_SEM_POSIX_NAMED:
+	case CS_METHOD_SEM_SYSV:
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
+	case CS_METHOD_MQ_SYSV:
+	case CS_METHOD_EVENTFD:
+	case CS_METHOD_PIPE:
+	case CS_METHOD_SOCKETPAIR:
+		cs_lock_leave(&cs_lock_global, id);
+		break;
+	case CS_METHOD_DELEGATE:
+	case CS_METHOD_MQ_POSIX_PAYLOAD:
+	case CS_METHOD_MQ_POSIX_PRIO:
+		break;
+	case CS_METHOD_IO_URING:
+#ifdef CS_HAVE_IO_URING
+		write(io_uring_locked, &eventfd_one, sizeof(eventfd_one));
+																// no error checking due to performance testing
+																// return the token directly: an IORING_OP_WRITE
+																// of the eventfd is punted to io-wq and the token
+																// was seen stuck there with the waits armed
+#endif
+		break;
+	case CS_METHOD_COHORT:
+		cohort = &cohort_nodes[cohort_threads[id].node];
+		next = atomic_load_explicit(&cohort->serving, memory_order_relaxed) + 1;
+		if (atomic_load_explicit(&cohort->ticket, memory_order_relaxed) != next
+				&& cohort->handoffs < COHORT_HANDOFFS) {
+			++cohort->handoffs;									// a thread of the node waits: pass it the global lock too
+		} else {
+			cohort->global_held = false;						// nobody local or the bound reached: let other nodes in
+			cs_order_release(&cohort_global);
+		}
+		atomic_store_explicit(&cohort->serving, next, memory_order_release);
+																// memory_order_release: publish global_held and the data
+		break;
+	case CS_METHOD_PETERSON:
+		atomic_store_explicit(&peterson_flag[id], false, memory_order_release);
+		break;
+	case CS_METHOD_FILTER:
+		atomic_store_explicit(&filter_level[id], 0, memory_order_release);
+		break;
+	case CS_METHOD_BAKERY:
+		atomic_store_explicit(&bakery_number[id], 0, memory_order_release);
+		break;
+	case CS_METHOD_RTM:
+#ifdef CS_HAVE_RTM
+		rtm_leave(id);
+#endif
+		break;
+	}
+}
+
+// the transactions are run by a server thread, see cs_delegate()
+bool cs_delegating(void)
+{
+	return cs_method_used == CS_METHOD_DELEGATE
+		|| cs_method_used == CS_METHOD_MQ_POSIX_PAYLOAD || cs_method_used == CS_METHOD_MQ_POSIX_PRIO;
+}
+
+// the waiting threads spin instead of blocking, see busy_wait_yields
+bool cs_busy_waiting(void)
+{
+	return (cs_method_used >= CS_METHOD_MIN && cs_method_used <= CS_METHODS_BUSY_WAIT)
+		|| cs_method_used == CS_METHOD_DELEGATE || cs_method_used == CS_METHOD_COHORT
+		|| (cs_method_used >= CS_METHOD_PETERSON && cs_method_used <= CS_METHOD_BAKERY)
+		|| cs_method_used == CS_METHOD_OCC || cs_method_used == CS_METHOD_RTM;
+}
+
+// delegate the transaction to the server thread, returns its result
+bool cs_delegate(int id, long amount)
+{
+	struct delegate_ring *ring = &delegate_rings[id];
+	long tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	struct mq_posix_request request;
+
+	if (cs_method_used == CS_METHOD_MQ_POSIX_PAYLOAD || cs_method_used == CS_METHOD_MQ_POSIX_PRIO) {
+		request.id = id;
+		request.amount = amount;
+		mq_send(mq_posix_locked, (char *) &request, sizeof(request),
+				cs_method_used == CS_METHOD_MQ_POSIX_PRIO ? id % MQ_POSIX_PRIORITIES : 0);
+											// no error checking due to performance testing
+											// msg_prio: higher priority threads are served first
+		sem_wait(&mq_posix_replies[id]);	// wait for the reply
+		return mq_posix_results[id];
+	}
+
+	while (tail - atomic_load_explicit(&ring->head, memory_order_relaxed) >= DELEGATE_RING) {
+															// the ring is full: wait for the server
+		if (busy_wait_yields) {
+			sched_yield();
+		}
+	}
+	ring->amount[tail % DELEGATE_RING] = amount;
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+															// memory_order_release: publish the request with tail
+	while (atomic_load_explicit(&delegate_slots[id].done, memory_order_acquire) <= tail) {
+															// wait for the completion of the request
+		if (busy_wait_yields) {
+			sched_yield();
+		}
+	}
+	return delegate_slots[id].result;
+}
+
+// place the lock data of the method on the NUMA node, returns -1 on failure
+// the kernel objects (System V IPC, message queues, file descriptors) stay where the kernel puts them
+int cs_bind(int node)
+{
+	switch (cs_method_used) {
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+		return cs_mbind(cs_lock_global.locked, sizeof(*cs_lock_global.locked), node);
+	case CS_METHOD_XCHG:
+		return cs_mbind(cs_lock_global.xchg_locked, sizeof(*cs_lock_global.xchg_locked), node);
+	case CS_METHOD_MUTEX:
+	case CS_METHOD_MUTEX_PI:
+		return cs_mbind(cs_lock_global.mutex_locked, sizeof(*cs_lock_global.mutex_locked), node);
+	case CS_METHOD_SEM_POSIX:
+		return cs_mbind(&cs_lock_global.sem_locked, sizeof(cs_lock_global.sem_locked), node);
+	case CS_METHOD_DELEGATE:
+		if (cs_mbind(delegate_rings, cs_thread_count * sizeof(*delegate_rings), node) == -1)
+			return -1;
+		return cs_mbind(delegate_slots, cs_thread_count * sizeof(*delegate_slots), node);
+	case CS_METHOD_COHORT:
+		if (cs_mbind(cohort_nodes, sizeof(cohort_nodes), node) == -1)
+			return -1;
+		return cs_mbind(&cohort_global, sizeof(cohort_global), node);
+	case CS_METHOD_PETERSON:
+		if (cs_mbind(peterson_flag, sizeof(peterson_flag), node) == -1)
+			return -1;
+		return cs_mbind(&peterson_turn, sizeof(peterson_turn), node);
+	case CS_METHOD_FILTER:
+		if (cs_mbind(filter_level, cs_thread_count * sizeof(*filter_level), node) == -1)
+			return -1;
+		return cs_mbind(filter_victim, cs_thread_count * sizeof(*filter_victim), node);
+	case CS_METHOD_BAKERY:
+		if (cs_mbind(bakery_choosing, cs_thread_count * sizeof(*bakery_choosing), node) == -1)
+			return -1;
+		return cs_mbind(bakery_number, cs_thread_count * sizeof(*bakery_number), node);
+	case CS_METHOD_RTM:
+		if (cs_mbind(rtm_stats, cs_thread_count * sizeof(*rtm_stats), node) == -1)
+			return -1;
+		return cs_mbind(&rtm_locked, sizeof(rtm_locked), node);
+	}
+	return 0;
+}
+
+// print the state of the lock, used when the threads stop progressing
+// the state is read without locking: it may be changing
+void cs_dump(FILE *stream)
+{
+	struct mq_attr attr;
+	int value, i;
+
+	fprintf(stream, "Lock state of method %d: ", cs_method_used);
+	switch (cs_method_used) {
+	case CS_METHOD_ATOMIC:
+	case CS_METHOD_OCC:
+		fprintf(stream, "no lock\n");
+		return;
+	case CS_METHOD_LOCKED:
+	case CS_METHOD_TEST_XCHG:
+		fprintf(stream, "locked %d\n", *cs_lock_global.locked);
+		return;
+	case CS_METHOD_XCHG:		// atomic_flag has no load: GCC keeps the flag in its first byte
+		fprintf(stream, "flag byte %d\n", *(volatile unsigned char *) cs_lock_global.xchg_locked);
+		return;
+	case CS_METHOD_MUTEX:
+	case CS_METHOD_MUTEX_PI:
+		fprintf(stream, "lock word %d, owner TID %d\n",	// glibc on Linux: the futex and the owner
+				cs_lock_global.mutex_locked->__data.__lock, cs_lock_global.mutex_locked->__data.__owner);
+		return;
+	case CS_METHOD_SEM_POSIX:
+	case CS_METHOD_SEM_POSIX_NAMED:
+		if (sem_getvalue(cs_method_used == CS_METHOD_SEM_POSIX ? &cs_lock_global.sem_locked : cs_lock_global.psem_named_locked, &value) == 0) {
+			fprintf(stream, "semaphore value %d\n", value);
+			return;
+		}
+		break;
+	case CS_METHOD_SEM_SYSV:
+	case CS_METHOD_SEM_SYSV_NOUNDO:
+	case CS_METHOD_SEM_SYSV_TIMED:
+	case CS_METHOD_SEM_SYSV_MULTI:
+		if ((value = semctl(cs_lock_global.sem_sys_v_locked, 0, GETVAL)) != -1) {
+			fprintf(stream, "semaphore value %d, waiting %d\n", value, semctl(cs_lock_global.sem_sys_v_locked, 0, GETNCNT));
+			return;
+		}
+		break;
+	case CS_METHOD_MQ_POSIX:
+	case CS_METHOD_MQ_POSIX_SPIN:
+	case CS_METHOD_MQ_POSIX_PAYLOAD:
+	case CS_METHOD_MQ_POSIX_PRIO:
+		if (mq_getattr(cs_method_used == CS_METHOD_MQ_POSIX || cs_method_used == CS_METHOD_MQ_POSIX_SPIN
+				? cs_lock_global.mq_posix_locked : mq_posix_locked, &attr) == 0) {
+			fprintf(stream, "messages in the queue %ld\n", attr.mq_curmsgs);
+			return;
+		}
+		break;
+	case CS_METHOD_DELEGATE:
+		for (i = 0; i < cs_thread_count; ++i)
+			fprintf(stream, "%sring %d: head %ld tail %ld", i ? ", " : "", i,
+					atomic_load(&delegate_rings[i].head), atomic_load(&delegate_rings[i].tail));
+		fprintf(stream, "\n");
+		return;
+	case CS_METHOD_COHORT:
+		fprintf(stream, "global %d", atomic_load(&cohort_global));
+		for (i = 0; i < COHORT_NODES; ++i)
+			if (atomic_load(&cohort_nodes[i].ticket))
+				fprintf(stream, ", node %d: ticket %u serving %u global held %d", i,
+						atomic_load(&cohort_nodes[i].ticket), atomic_load(&cohort_nodes[i].serving),
+						cohort_nodes[i].global_held);
+		fprintf(stream, "\n");
+		return;
+	case CS_METHOD_PETERSON:
+		fprintf(stream, "flags %d %d, turn %d\n", atomic_load(&peterson_flag[0]), atomic_load(&peterson_flag[1]),
+				atomic_load(&peterson_turn));
+		return;
+	case CS_METHOD_FILTER:
+		for (i = 0; i < cs_thread_count; ++i)
+			fprintf(stream, "%slevel %d", i ? ", " : "", atomic_load(&filter_level[i]));
+		fprintf(stream, "\n");
+		return;
+	case CS_METHOD_BAKERY:
+		for (i = 0; i < cs_thread_count; ++i)
+			fprintf(stream, "%snumber %ld", i ? ", " : "", atomic_load(&bakery_number[i]));
+		fprintf(stream, "\n");
+		return;
+	case CS_METHOD_RTM:
+		fprintf(stream, "fallback lock %d\n", atomic_load(&rtm_locked));
+		return;
+	default:
+		fprintf(stream, "kept by the kernel\n");
+		return;
+	}
+	fprintf(stream, "unknown\n");
+}
+
+// the CS_LAYOUT_DATA bytes for the protected data placed by cs_layout, NULL = the caller's own globals
+void *cs_layout_data(void)
+{
+	switch (cs_layout) {
+	case CS_LAYOUT_SHARED:
+		return cs_shared_line.data;
+	case CS_LAYOUT_PADDED:
+		return cs_padded_lines.data;
+	default:
+		return NULL;
+	}
+}
+
+// print the statistics the method collects, if any
+void cs_report(FILE *stream)
+{
+	long commits = 0, fallbacks = 0, aborts[RTM_REASONS] = { 0 };
+	int i, reason;
+
+	if (cs_method_used != CS_METHOD_RTM)
+		return;
+	for (i = 0; i < cs_thread_count; ++i) {
+		commits += rtm_stats[i].commits;
+		fallbacks += rtm_stats[i].fallbacks;
+		for (reason = 0; reason < RTM_REASONS; ++reason)
+			aborts[reason] += rtm_stats[i].aborts[reason];
 	}
+	fprintf(stream, "Lock elision (commits, fallbacks, elided %%): %ld %ld %.2lf\n", commits, fallbacks,
+			commits + fallbacks > 0 ? 100.0 * commits / (commits + fallbacks) : 0.0);
+	fprintf(stream, "Transaction aborts by the cause:");
+	for (reason = 0; reason < RTM_REASONS; ++reason)
+		fprintf(stream, "%s %s %ld", reason ? "," : "", rtm_reasons[reason], aborts[reason]);
+	fprintf(stream, "\n");
 }
 
 // vim:ts=4:sw=4